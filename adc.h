@@ -54,6 +54,9 @@
 #ifndef HAL_UC_ADC_H
 #define HAL_UC_ADC_H
 
+#include <platform/types.h>
+#include "map.h"
+
 /**
  * @name ADC API Functions
  * 
@@ -63,8 +66,40 @@ void adc_init(uint8_t intfnum);
 
 void adc_setup_channel(uint8_t intfnum, uint8_t chnum, uint16_t * rbuf);
 
+/**
+ * @brief Trigger a single conversion of a channel on interface 0.
+ * @param chnum ADC channel number.
+ * 
+ * The result is written to the `rbuf` provided to adc_setup_channel(). 
+ * Retained for existing single ADC applications. 
+ * 
+ * @see adc_trigger()
+ */
 void adc_trigger_single(uint8_t chnum);
 
+/**
+ * @brief Trigger a single conversion of a channel on any interface.
+ * @param intfnum Identifier of the ADC interface.
+ * @param chnum ADC channel number.
+ * 
+ * The result is written to the `rbuf` provided to adc_setup_channel(), 
+ * and the channel's sequence number is incremented once it is. 
+ * 
+ * @see adc_get_seq()
+ */
+void adc_trigger(uint8_t intfnum, uint8_t chnum);
+
+/**
+ * @brief Get the completion sequence number of a channel.
+ * @param intfnum Identifier of the ADC interface.
+ * @param chnum ADC channel number.
+ * @return Number of conversions completed on the channel, modulo 2^16.
+ * 
+ * Applications watching `rbuf` can compare this against a previously read 
+ * value to know whether the value in `rbuf` is fresh.
+ */
+static inline uint16_t adc_get_seq(uint8_t intfnum, uint8_t chnum);
+
 // void adc_setup_autoscan(uint8_t intfnum, uint16_t chnmask);
 
 // void adc_trigger_autoscan(void);
@@ -72,6 +107,318 @@ void adc_trigger_single(uint8_t chnum);
 
 /**@}*/ 
 
+/**
+ * @name ADC Asynchronous Conversion API
+ * 
+ * Conversions are requested by enqueueing a conversion descriptor on an 
+ * ADC interface, much like SPI transactions. Each interface has its own 
+ * queue, and the implementation runs the queues of different interfaces 
+ * independently, so several ADCs can be kept busy at once. 
+ * 
+ * When a conversion completes, the result, the channel's sequence number 
+ * and a timestamp are written into the descriptor, its status is set to
+ * ADC_CONV_DONE and the callback, if any, is called. The callback runs in 
+ * interrupt context and should be kept short. It may enqueue further 
+ * conversions, including the one it was called with.
+ * 
+ * The timestamp is the count of the implementation's timestamp source at
+ * completion, typically a free-running timer, and is only meaningful 
+ * relative to other timestamps from the same source. 
+ * 
+ * Descriptors are owned by the application and must remain valid until 
+ * the conversion is done or cancelled.
+ */
+/**@{*/ 
+
+#define ADC_CONV_IDLE           0
+#define ADC_CONV_PENDING        1
+#define ADC_CONV_ACTIVE         2
+#define ADC_CONV_DONE           3
+#define ADC_CONV_CANCELLED      4
+
+typedef struct ADC_CONVERSION_t{
+    struct ADC_CONVERSION_t * next;
+    void (* callback) (struct ADC_CONVERSION_t *);
+    uint8_t chnum;
+    volatile uint8_t status;
+    volatile uint16_t value;
+    volatile uint16_t seq;
+    volatile uint16_t timestamp;
+}adc_conversion_t;
+
+/**
+ * @brief Enqueue a conversion on an ADC interface.
+ * @param intfnum Identifier of the ADC interface.
+ * @param conversion Pointer to the conversion descriptor. 
+ * 
+ * The conversion is started immediately if the interface is idle. 
+ */
+static inline void adc_enqueue_conversion(uint8_t intfnum, 
+                                          adc_conversion_t * conversion);
+
+/**
+ * @brief Remove a conversion from an ADC interface's queue.
+ * @param intfnum Identifier of the ADC interface.
+ * @param conversion Pointer to the conversion descriptor. 
+ * 
+ * A pending conversion is removed and marked ADC_CONV_CANCELLED, without 
+ * calling its callback. A conversion which is already active is allowed 
+ * to complete normally.
+ */
+static inline void adc_cancel_conversion(uint8_t intfnum, 
+                                         adc_conversion_t * conversion);
+
+/**
+ * @brief Check whether an ADC interface has any conversions queued.
+ * @param intfnum Identifier of the ADC interface.
+ * @return 1 if the queue is empty and the interface idle, 0 otherwise.
+ */
+static inline uint8_t adc_queue_empty(uint8_t intfnum);
+
+/**@}*/ 
+
+/**
+ * @name ADC Timer Trigger API Functions
+ * 
+ * Fixed rate sampling by calling adc_trigger_single() from a timer ISR adds 
+ * the IRQ entry latency, and anything else which happens to hold off the 
+ * interrupt, to every sampling instant. These functions instead link the 
+ * compare match event of a timer channel directly to the conversion trigger 
+ * of an ADC interface.
+ * 
+ * Where the silicon can route the compare event to the ADC (the ADC12 sample
+ * and hold source select on MSP430, for instance), the implementation should 
+ * do so, and sampling will then be jitter-free. Where it cannot, or where the 
+ * requested timer channel is not one of those the ADC can be wired to, the 
+ * implementation falls back to starting the conversion as the very first 
+ * thing in that timer channel's compare handler, before any other work is 
+ * done in `timer_handlers.h`. 
+ * 
+ * The timer interface itself is to be set up by the application using the 
+ * timer API, typically in UP mode with TOP setting the sampling period and 
+ * the linked channel's compare value setting the phase. 
+ * 
+ * Only one timer trigger can be linked to each ADC interface at a time.
+ */
+/**@{*/ 
+
+/** \brief No timer trigger is linked to the ADC interface */
+#define ADC_TRIGGER_NONE        0
+
+/** \brief Timer compare event is routed to the ADC in hardware */
+#define ADC_TRIGGER_HW          1
+
+/** \brief Conversion is started from the timer channel compare handler */
+#define ADC_TRIGGER_SW          2
+
+/**
+ * @brief Link a timer channel compare event to the ADC conversion trigger.
+ * @param intfnum Identifier of the ADC interface.
+ * @param chnum ADC channel to convert on each trigger. The channel should 
+ *              already be set up using adc_setup_channel().
+ * @param timer_intfnum Identifier of the timer interface.
+ * @param timer_channel Timer channel whose compare match should trigger the 
+ *              conversion. 
+ * @return Trigger mechanism used, as one of the ADC_TRIGGER_* defines. 
+ *         ADC_TRIGGER_NONE indicates that the link could not be made.
+ * 
+ * The hardware mechanism is always preferred when available. The software 
+ * fallback enables the compare match interrupt for the timer channel, and 
+ * the application should not use that interrupt for anything else while the 
+ * link is in place.
+ * 
+ * @see adc_unlink_timer_trigger()
+ */
+uint8_t adc_link_timer_trigger(uint8_t intfnum, uint8_t chnum, 
+                               uint8_t timer_intfnum, uint8_t timer_channel);
+
+/**
+ * @brief Remove the timer trigger linked to the ADC interface, if any.
+ * @param intfnum Identifier of the ADC interface.
+ * 
+ * Any conversion already in progress is allowed to complete. 
+ */
+void adc_unlink_timer_trigger(uint8_t intfnum);
+
+/**
+ * @brief Get the trigger mechanism currently linked to the ADC interface.
+ * @param intfnum Identifier of the ADC interface.
+ * @return One of the ADC_TRIGGER_* defines.
+ */
+static inline uint8_t adc_get_trigger_type(uint8_t intfnum);
+
+#if APP_SUPPORT_ADC_TRIGGER_STATS
+
+/**
+ * Trigger latency statistics, in timer ticks. Latency is the timer count 
+ * at which the conversion was actually started, less the compare value of 
+ * the linked channel. Jitter is then `latency_max - latency_min`. 
+ * 
+ * With a hardware trigger, the implementation may report zeros, since the 
+ * start of sampling is fixed by the silicon. These statistics are primarily
+ * intended to quantify the software fallback, and to compare it against 
+ * the hardware trigger on platforms which have both. 
+ */
+typedef struct ADC_TRIGGER_STATS_t{
+    uint32_t count;
+    uint16_t latency_min;
+    uint16_t latency_max;
+    uint32_t latency_sum;
+}adc_trigger_stats_t;
+
+/**
+ * @brief Read the trigger latency statistics of the ADC interface.
+ * @param intfnum Identifier of the ADC interface.
+ * @param stats Pointer to the structure the statistics are copied into.
+ */
+void adc_get_trigger_stats(uint8_t intfnum, adc_trigger_stats_t * stats);
+
+/**
+ * @brief Reset the trigger latency statistics of the ADC interface.
+ * @param intfnum Identifier of the ADC interface.
+ */
+void adc_clear_trigger_stats(uint8_t intfnum);
+
+#endif
+
+/**@}*/ 
+
+#if APP_SUPPORT_ADC_PIPELINE
+
+/**
+ * @name ADC Pipeline API Functions
+ * 
+ * Optional block-based post-processing of completed ADC buffers. Each 
+ * channel which is to be processed gets its own configuration and state, 
+ * and samples pass through the following stages, in order : 
+ * 
+ *  - Calibration : `((raw + offset) * gain) >> 14`, with gain in Q2.14. 
+ *    The offset sum is first saturated to the range 0 to 0xFFFF, a 
+ *    negative sum being clamped to 0. The product of that and the gain is 
+ *    then an unsigned 16 x 16 bit multiply, which is at most 0xFFFE0001 
+ *    and always fits in 32 bits. After the shift, the result is saturated 
+ *    to 0xFFFF. Gains above ADC_PIPELINE_GAIN_UNITY can therefore only 
+ *    saturate, never wrap.
+ *  - Min / Max tracking on the saturated calibrated value.
+ *  - Decimation by a power of two, either as a boxcar (moving) average or 
+ *    as a CIC filter of upto ADC_PIPELINE_CIC_MAX_ORDER stages.
+ * 
+ * All arithmetic is fixed point. Decimation ratios are restricted to powers 
+ * of two so that normalization is a shift and not a division. Decimated 
+ * output is normalized by the filter's gain, `ratio_log2` bits for the 
+ * average and `cic_order * ratio_log2` bits for the CIC, and so is in the 
+ * same 16 bit range as the calibrated value. 
+ * 
+ * The CIC integrators and combs are 32 bit unsigned and rely on modulo 2^32 
+ * wrap-around, which is well defined for unsigned arithmetic. This gives 
+ * the correct result only while the register growth fits, that is, while 
+ * `16 + cic_order * ratio_log2 <= 32`. The product `cic_order * ratio_log2` 
+ * may therefore be at most ADC_PIPELINE_CIC_MAX_GROWTH, which limits the 
+ * ratio to 32 for a third order CIC, or 256 for a second order one. 
+ * adc_pipeline_setup() rejects configurations which exceed it.
+ * 
+ * Blocks are processed in word-packed batches, two 16 bit samples per 32 
+ * bit read, so input buffers should be word aligned. The odd trailing 
+ * sample of a block, if any, is handled one at a time. 
+ * 
+ * The application provides the memory for the pipeline state. Nothing is
+ * allocated by the implementation.
+ */
+/**@{*/ 
+
+#ifndef ADC_PIPELINE_CIC_MAX_ORDER
+    #define ADC_PIPELINE_CIC_MAX_ORDER  3
+#endif
+
+/** \brief Maximum CIC register growth, in bits, for 32 bit integrators */
+#define ADC_PIPELINE_CIC_MAX_GROWTH     16
+
+/** \brief Unity gain in the Q2.14 calibration gain format */
+#define ADC_PIPELINE_GAIN_UNITY         0x4000
+
+typedef enum ADC_PIPELINE_DECIMATION_t{
+    ADC_PIPELINE_DECIMATE_NONE,
+    ADC_PIPELINE_DECIMATE_AVERAGE,
+    ADC_PIPELINE_DECIMATE_CIC
+}adc_pipeline_decimation_t;
+
+typedef struct ADC_PIPELINE_CONF_t{
+    int16_t offset;
+    uint16_t gain;
+    adc_pipeline_decimation_t decimation;
+    uint8_t ratio_log2;
+    uint8_t cic_order;
+}adc_pipeline_conf_t;
+
+typedef struct ADC_PIPELINE_t{
+    const adc_pipeline_conf_t * conf;
+    uint32_t integrator[ADC_PIPELINE_CIC_MAX_ORDER];
+    uint32_t comb[ADC_PIPELINE_CIC_MAX_ORDER];
+    uint16_t phase;
+    uint16_t min;
+    uint16_t max;
+    uint32_t samples;
+}adc_pipeline_t;
+
+/**
+ * @brief Attach a pipeline to an ADC channel.
+ * @param intfnum Identifier of the ADC interface.
+ * @param chnum ADC channel number.
+ * @param conf Pointer to the channel's pipeline configuration. This is 
+ *             kept by reference and should not go out of scope.
+ * @param state Pointer to application provided pipeline state, which will 
+ *              be reset by this function.
+ * @return 1 for success, 0 for error. Configurations with a CIC order of 
+ *         0 or above ADC_PIPELINE_CIC_MAX_ORDER, or with a register growth 
+ *         above ADC_PIPELINE_CIC_MAX_GROWTH, are rejected and the channel 
+ *         is left without a pipeline. 
+ */
+uint8_t adc_pipeline_setup(uint8_t intfnum, uint8_t chnum, 
+                           const adc_pipeline_conf_t * conf, 
+                           adc_pipeline_t * state);
+
+/**
+ * @brief Process a block of completed samples from an ADC channel.
+ * @param intfnum Identifier of the ADC interface.
+ * @param chnum ADC channel number.
+ * @param in Pointer to the raw samples. Should be word aligned.
+ * @param len Number of raw samples in the block.
+ * @param out Pointer to the buffer the output samples are written to. This 
+ *            may be the same as `in`, since output never runs ahead of 
+ *            input.
+ * @return Number of output samples written.
+ * 
+ * Decimation state is carried across calls, so block lengths need not be 
+ * multiples of the decimation ratio. 
+ */
+uint16_t adc_pipeline_process(uint8_t intfnum, uint8_t chnum, 
+                              const uint16_t * in, uint16_t len, 
+                              uint16_t * out);
+
+/**
+ * @brief Reset the min / max tracking of an ADC channel's pipeline.
+ * @param intfnum Identifier of the ADC interface.
+ * @param chnum ADC channel number.
+ */
+void adc_pipeline_clear_minmax(uint8_t intfnum, uint8_t chnum);
+
+/**
+ * @brief Get the pipeline state of an ADC channel.
+ * @param intfnum Identifier of the ADC interface.
+ * @param chnum ADC channel number.
+ * @return Pointer to the pipeline state, or 0 if none is attached. 
+ * 
+ * The `min`, `max` and `samples` fields may be read from the returned 
+ * state. `samples` counts raw samples processed since setup, and together 
+ * with a timestamp taken around adc_pipeline_process() gives the achieved 
+ * throughput in samples/sec on the target.
+ */
+static inline adc_pipeline_t * adc_pipeline_get(uint8_t intfnum, uint8_t chnum);
+
+/**@}*/ 
+
+#endif
+
 // Set up the implementation
 #include "uc/adc_impl.h"
 
@@ -76,11 +76,15 @@
 // #include "id.h"
 // #include "adc.h"
 // #include "core.h"
+// #include "sched.h"
 // #include "entropy.h"
 #include "gpio.h"
 #include "uart.h"
+// #include "mux.h"
+// #include "tbench.h"
 // #include "spi.h"
 // #include "timer.h"
+// #include "profile.h"
 // #include "usb.h"
 
 #endif
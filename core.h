@@ -30,8 +30,90 @@
 #ifndef HAL_UC_CORE_H
 #define HAL_UC_CORE_H
 
+#include <platform/types.h>
 #include "map.h"
 
+/**
+ * @name Critical Section API Functions
+ * 
+ * Nestable critical sections. The state returned on entry is to be passed 
+ * back on exit, and exiting restores it rather than unconditionally 
+ * re-enabling interrupts, so sections can nest freely. 
+ * 
+ * Priority masked sections mask only interrupts at or below the given 
+ * priority, leaving more urgent ones running. Levels are platform specific
+ * and defined by the implementation as `IRQ_PRIORITY_*`. On platforms with 
+ * no interrupt priority masking (MSP430, for instance), they behave exactly 
+ * as a full critical section. 
+ * 
+ * Keep sections short. When APP_SUPPORT_CRITICAL_STATS is set, the 
+ * implementation records the longest interval spent with interrupts masked 
+ * through these functions, in core cycles. 
+ */
+/**@{*/ 
+/** Mask all interrupts and return the previous state. */
+static inline HAL_BASE_t critical_enter(void);
+
+/** Restore the interrupt state returned by critical_enter(). */
+static inline void critical_exit(HAL_BASE_t state);
+
+/** Mask interrupts at or below the priority and return the previous state. */
+static inline HAL_BASE_t critical_enter_priority(uint8_t priority);
+
+/** Restore the state returned by critical_enter_priority(). */
+static inline void critical_exit_priority(HAL_BASE_t state);
+
+#if APP_SUPPORT_CRITICAL_STATS
+/** Get the longest interrupts-masked window seen, in core cycles. */
+static inline uint32_t critical_get_max_window(void);
+
+/** Reset the longest interrupts-masked window. */
+static inline void critical_clear_max_window(void);
+#endif
+/**@}*/ 
+
+/**
+ * @name Atomic API Functions
+ * 
+ * Atomic access to variables shared with ISRs. Each implementation uses 
+ * the cheapest sequence available on the platform : plain accesses where 
+ * the access is naturally atomic (upto the native word width), exclusive 
+ * load / store or single read-modify-write instructions where they exist, 
+ * and a short critical section otherwise. 
+ */
+/**@{*/ 
+static inline uint8_t atomic_load_u8(volatile uint8_t * ptr);
+static inline uint16_t atomic_load_u16(volatile uint16_t * ptr);
+static inline uint32_t atomic_load_u32(volatile uint32_t * ptr);
+
+static inline void atomic_store_u8(volatile uint8_t * ptr, uint8_t value);
+static inline void atomic_store_u16(volatile uint16_t * ptr, uint16_t value);
+static inline void atomic_store_u32(volatile uint32_t * ptr, uint32_t value);
+
+/** Store `desired` if `*ptr` equals `expected`. Return 1 if stored, 0 otherwise. */
+static inline uint8_t atomic_cas_u8(volatile uint8_t * ptr, 
+                                    uint8_t expected, uint8_t desired);
+static inline uint8_t atomic_cas_u16(volatile uint16_t * ptr, 
+                                     uint16_t expected, uint16_t desired);
+static inline uint8_t atomic_cas_u32(volatile uint32_t * ptr, 
+                                     uint32_t expected, uint32_t desired);
+
+/** Add `value` to `*ptr` and return the previous contents. */
+static inline uint8_t atomic_fetch_add_u8(volatile uint8_t * ptr, uint8_t value);
+static inline uint16_t atomic_fetch_add_u16(volatile uint16_t * ptr, uint16_t value);
+static inline uint32_t atomic_fetch_add_u32(volatile uint32_t * ptr, uint32_t value);
+
+/** OR `value` into `*ptr` and return the previous contents. */
+static inline uint8_t atomic_fetch_or_u8(volatile uint8_t * ptr, uint8_t value);
+static inline uint16_t atomic_fetch_or_u16(volatile uint16_t * ptr, uint16_t value);
+static inline uint32_t atomic_fetch_or_u32(volatile uint32_t * ptr, uint32_t value);
+
+/** AND `value` into `*ptr` and return the previous contents. */
+static inline uint8_t atomic_fetch_and_u8(volatile uint8_t * ptr, uint8_t value);
+static inline uint16_t atomic_fetch_and_u16(volatile uint16_t * ptr, uint16_t value);
+static inline uint32_t atomic_fetch_and_u32(volatile uint32_t * ptr, uint32_t value);
+/**@}*/ 
+
 /**
  * @name Watchdog API Functions
  * Various functions to control the primary watchdog. Implementation is 
@@ -53,33 +135,388 @@ void watchdog_clear(void);
 void watchdog_init(void);
 /**@}*/ 
 
+#if APP_SUPPORT_WATCHDOG_SUPERVISOR
+
+/**
+ * @name Watchdog Supervisor API Functions
+ * 
+ * A supervisor on top of the primary watchdog for upto 16 subsystems, each 
+ * of which is identified by one bit of a mask. Each registered subsystem 
+ * must check in within its window, measured in milliseconds from its 
+ * own previous check-in (or from registration or resumption). Windows are 
+ * tracked per subsystem, so there are no global rounds : 
+ * 
+ *  - A check-in at or after `window_min` is good, and restarts that 
+ *    subsystem's window. A fast subsystem may therefore check in any number 
+ *    of times while a slower one completes a single window, provided each 
+ *    of its check-ins is at least `window_min` after its previous one. 
+ *  - A check-in before `window_min` is a violation. 
+ *  - Reaching `window_max` without a check-in is a miss. 
+ * 
+ * The hardware watchdog is cleared by the supervisor itself, from a 
+ * periodic software timer at half the hardware interval, given by 
+ * uC_WATCHDOG_INTERVAL_MS from the map, for as long as no expected 
+ * subsystem has missed or violated its window. Windows much longer than 
+ * the hardware interval therefore work as expected. Once any subsystem 
+ * faults, clearing stops, and the watchdog resets the device within one 
+ * hardware interval, even though the main loop is still running. 
+ * 
+ * Once the supervisor is initialized, the application should not call 
+ * watchdog_clear() directly.
+ * 
+ * Subsystems which are legitimately idle, for instance while their 
+ * peripheral is powered down, should be suspended so that they are not 
+ * expected. The supervisor's clearing timer is not counted as a deadline 
+ * by the power manager. When the power manager enters a mode in which the 
+ * watchdog would expire before the next other software timer deadline, it 
+ * holds the watchdog and restarts it on wake, reopening every subsystem's 
+ * window. The core does not need to wake just to clear it. 
+ */
+/**@{*/ 
+
+#if !APP_SUPPORT_SWTIMER
+    #error "The watchdog supervisor requires APP_SUPPORT_SWTIMER"
+#endif
+
+/**
+ * @brief Initialize the supervisor and the primary watchdog.
+ */
+void wdsup_init(void);
+
+/**
+ * @brief Register a subsystem with the supervisor.
+ * @param client Bit number identifying the subsystem, 0 to 15.
+ * @param window_min Earliest acceptable check-in, in ms. 0 for no limit.
+ * @param window_max Latest acceptable check-in, in ms.
+ * @return 1 for success, 0 for error. Registration is rejected if `client` 
+ *         is out of range, if `window_max` is not greater than 
+ *         `window_min`, or if `window_max` is shorter than the 
+ *         supervisor's own clearing period (half of 
+ *         uC_WATCHDOG_INTERVAL_MS), which is the resolution at which 
+ *         misses are detected.
+ */
+uint8_t wdsup_register(uint8_t client, uint16_t window_min, uint16_t window_max);
+
+/**
+ * @brief Check in on behalf of one or more subsystems.
+ * @param mask Mask of the subsystems checking in.
+ */
+static inline void wdsup_checkin(uint16_t mask);
+
+/**
+ * @brief Stop expecting check-ins from one or more subsystems.
+ * @param mask Mask of the subsystems to suspend.
+ */
+static inline void wdsup_suspend(uint16_t mask);
+
+/**
+ * @brief Resume expecting check-ins from one or more subsystems.
+ * @param mask Mask of the subsystems to resume. Their windows reopen now.
+ */
+static inline void wdsup_resume(uint16_t mask);
+
+/**
+ * @brief Get the subsystems which caused the last supervisor reset.
+ * @return Mask of the subsystems which had missed or violated their 
+ *         windows when the watchdog was last allowed to expire, or 0 if 
+ *         the last reset was not caused by the supervisor.
+ */
+uint16_t wdsup_get_last_fault(void);
+
+/**@}*/ 
+
+#endif
+
 /**
  * @name Power Management API Functions
  * Various functions to control the power system. Implementation is 
  * left to the implementation layer at `core_impl.h`.
  */
 /**@{*/ 
-/** Set core voltage to the highest possible. The use of low power 
- modes will require exploring the common motifs of power system 
- selection and improving this API. For now, we don't care. Since this
- is a one-off thing, we'll also make it a regular function and not 
- bother about the overhead. */
+/** Set core voltage to the highest possible. Since this is a one-off 
+ thing, we'll also make it a regular function and not bother about the 
+ overhead. Low power modes are handled by the power manager below. */
 void power_set_full(void);
 /**@}*/ 
 
+#if APP_SUPPORT_POWER_MANAGER
+
+/**
+ * @name Power Manager API Functions
+ * 
+ * The implementation provides a table of the platform's sleep modes, in 
+ * order of increasing depth, with index 0 being the active mode (no sleep). 
+ * Each mode carries its wake latency and the minimum time it is worth 
+ * entering for, and a mask of the clocks which keep running in it. 
+ * 
+ * Peripheral drivers, and the application, constrain the deepest usable 
+ * mode through clients. A UART driver with RX enabled, for instance, would 
+ * limit sleep to modes which keep its clock running, and an SPI driver 
+ * with transactions in its queue or an active USB interface might keep the 
+ * core fully awake. Clients below POWER_CLIENT_APP are reserved for the 
+ * HAL drivers.
+ * 
+ * power_idle() is to be called from the main loop when there is nothing 
+ * else to do. It picks the deepest mode permitted by the clients whose 
+ * wake latency and minimum residency both fit before the next software 
+ * timer deadline, and which keeps the software timer's clock running if 
+ * there is a deadline at all. It then sleeps until the next interrupt. 
+ * There is no periodic tick to wake up for. 
+ * 
+ * To avoid losing a wakeup, the caller should mask interrupts with 
+ * critical_enter(), check for pending work, and call power_idle() only if 
+ * there is none, still within the critical section. power_idle() unmasks 
+ * interrupts atomically with the entry into sleep (as with setting GIE 
+ * together with the LPM bits on MSP430, or WFI with PRIMASK set on 
+ * Cortex-M), so an ISR which posts work after the check wakes the core 
+ * rather than being missed. It returns with the interrupt state restored 
+ * to what it was on entry, after the waking ISR has run, and the caller 
+ * then leaves the critical section with critical_exit(). 
+ */
+/**@{*/ 
+
+#if !APP_SUPPORT_SWTIMER
+    #error "The power manager requires APP_SUPPORT_SWTIMER"
+#endif
+
+#ifndef APP_POWER_NCLIENTS
+    #define APP_POWER_NCLIENTS      8
+#endif
+
+#define POWER_CLIENT_UART           0
+#define POWER_CLIENT_SPI            1
+#define POWER_CLIENT_USB            2
+#define POWER_CLIENT_ADC            3
+#define POWER_CLIENT_APP            4
+
+/** \brief Active mode. A client limit of this keeps the core awake. */
+#define POWER_MODE_ACTIVE           0
+
+typedef struct POWER_MODE_t{
+    uint8_t mode;
+    uint8_t clocks;
+    uint16_t wake_latency_us;
+    uint16_t min_residency_us;
+}power_mode_t;
+
+/** Sleep mode table, provided by the implementation. */
+extern const power_mode_t power_modes[uC_POWER_NMODES];
+
+/**
+ * @brief Limit the deepest mode usable while the client is active.
+ * @param client Client identifier.
+ * @param deepest Index into ::power_modes of the deepest mode usable.
+ */
+static inline void power_set_limit(uint8_t client, uint8_t deepest);
+
+/**
+ * @brief Remove the client's limit on the usable modes.
+ * @param client Client identifier.
+ */
+static inline void power_clear_limit(uint8_t client);
+
+/**
+ * @brief Sleep in the deepest suitable mode until the next interrupt.
+ * @return Index into ::power_modes of the mode that was used.
+ * 
+ * May be called with interrupts masked by critical_enter(), and should be 
+ * when the caller checks for pending work first. Interrupts are unmasked 
+ * atomically with entry into sleep, and the caller's interrupt state is 
+ * restored before returning. If the mode chosen is POWER_MODE_ACTIVE, 
+ * returns immediately without changing the interrupt state.
+ */
+uint8_t power_idle(void);
+
+/**@}*/ 
+
+#endif
+
 /**
  * @name Clock Management API Functions
  * Various functions to control the clock system. Implementation is 
  * left to the implementation layer at `core_impl.h`.
  */
 /**@{*/ 
-/** Set clock to some sane default. For now, we don't care about the 
- * details. Since this is a one-off thing, we'll also make it a regular 
- * function and not bother about the overhead. 
+/** Set clock to some sane default. When uC_CLOCK_STATIC is set, this 
+ * default is the static configuration from the map. Since this is a 
+ * one-off thing, we'll also make it a regular function and not bother 
+ * about the overhead. 
  */
 void clock_set_default(void);
+
+/**
+ * Clock identifiers. These map to the closest equivalent clocks on the 
+ * platform, MCLK, SMCLK and ACLK on MSP430 for instance.
+ */
+#define CLOCK_CORE              0
+#define CLOCK_PERIPH            1
+#define CLOCK_AUX               2
+
+/** Target frequencies, in Hz, for each clock. */
+typedef struct CLOCK_CONF_t{
+    uint32_t core;
+    uint32_t periph;
+    uint32_t aux;
+}clock_conf_t;
+
+/**
+ * @brief Configure the clock tree for the provided target frequencies.
+ * @param conf Pointer to the target frequencies.
+ * @return 1 for success, 0 for error.
+ * 
+ * Targets are validated against the silicon limits for each clock, given 
+ * by `uC_CLOCK_<CLOCK>_MAX` from the map, and against what the clock tree 
+ * can actually derive from its sources. If any target cannot be met to 
+ * within the platform's tolerance, nothing is changed and 0 is returned. 
+ * Use clock_get_freq() to obtain the frequencies actually achieved.
+ * 
+ * @warning With uC_CLOCK_STATIC set, a successful call voids the static 
+ *          CLOCK_*_FREQ constants and every divider folded from them, 
+ *          until clock_set_default() is called again. Nothing is retimed 
+ *          by this function. Applications which need to change clocks at 
+ *          runtime with a static configuration should do so through 
+ *          frequency scaling, whose notifiers retime the drivers, rather 
+ *          than by calling this directly.
+ */
+uint8_t clock_set(const clock_conf_t * conf);
+
+/**
+ * @brief Get the actual frequency of a clock.
+ * @param clock Clock identifier.
+ * @return Frequency in Hz.
+ * 
+ * With a static clock configuration, this should reduce to the 
+ * corresponding CLOCK_*_FREQ constant, unless frequency scaling is 
+ * enabled, in which case it always returns the current frequency.
+ */
+static inline uint32_t clock_get_freq(uint8_t clock);
+
+#if uC_CLOCK_STATIC
+
+/*
+ * Static clock configuration. The map provides the frequencies as
+ * uC_CLOCK_CORE_FREQ, uC_CLOCK_PERIPH_FREQ and uC_CLOCK_AUX_FREQ, which 
+ * clock_set_default() configures. Baud rate and prescaler dividers computed 
+ * from these using CLOCK_DIVIDER() fold at compile time.
+ * 
+ * When APP_SUPPORT_PERF_SCALING is also set, these constants describe only 
+ * the default performance level. Drivers must then not program dividers 
+ * folded from them, and should instead compute dividers from 
+ * clock_get_freq() in their notifier's `retime`. The constants remain 
+ * usable as the reference frequencies that scaled settings are relative to.
+ */
+
+#if uC_CLOCK_CORE_FREQ > uC_CLOCK_CORE_MAX
+    #error "uC_CLOCK_CORE_FREQ exceeds the silicon limit"
+#endif
+
+#if uC_CLOCK_PERIPH_FREQ > uC_CLOCK_PERIPH_MAX
+    #error "uC_CLOCK_PERIPH_FREQ exceeds the silicon limit"
+#endif
+
+#if uC_CLOCK_AUX_FREQ > uC_CLOCK_AUX_MAX
+    #error "uC_CLOCK_AUX_FREQ exceeds the silicon limit"
+#endif
+
+#define CLOCK_CORE_FREQ         uC_CLOCK_CORE_FREQ
+#define CLOCK_PERIPH_FREQ       uC_CLOCK_PERIPH_FREQ
+#define CLOCK_AUX_FREQ          uC_CLOCK_AUX_FREQ
+
+#endif
+
+/** Divider closest to producing `target` from a clock at `freq`, both in Hz. */
+#define CLOCK_DIVIDER(freq, target)     (((freq) + ((target) / 2)) / (target))
 /**@}*/ 
 
+#if APP_SUPPORT_PERF_SCALING
+
+/**
+ * @name Frequency Scaling API Functions
+ * 
+ * Performance levels are a table of clock configurations, provided by the 
+ * application, in order of increasing frequency. Clients request a level, 
+ * using the same client identifiers as the power manager, and the highest 
+ * level requested by any client is applied. 
+ * 
+ * `perf_levels[0]` must be the clock_set_default() configuration, which 
+ * with uC_CLOCK_STATIC is the static uC_CLOCK_*_FREQ frequencies. It is the 
+ * level applied when no client has a request outstanding, and is the 
+ * reference level that scaled driver settings are relative to. 
+ * 
+ * The timers behind the monotonic clock and the software timer service 
+ * must be clocked from a source which is the same at every level (the 
+ * auxiliary clock, typically), since uC_MONOTONIC_TIMER_FREQ and 
+ * MONOTONIC_US_MULT are compile-time constants and software timer 
+ * deadlines are in fixed ticks. Only the core and peripheral clocks should 
+ * differ between levels. 
+ * 
+ * Drivers whose timing derives from the clocks register a notifier. Before 
+ * a change, each notifier's `prepare` is called, and returns 1 once its 
+ * driver is at a safe boundary (UART TX shift register empty, no SPI 
+ * transaction mid-byte, etc.) and has paused further activity, or 0 to 
+ * defer the change. Deferred changes are retried from perf_reactor(). After 
+ * the change, each notifier's `retime` is called to recompute its dividers 
+ * from clock_get_freq() and resume. The UART, SPI and timer implementations 
+ * register their own notifiers, so in-flight transfers are not dropped. 
+ * 
+ * With frequency scaling in use, SPI `clkdivider` values and timer 
+ * prescalers are interpreted relative to the clock_set_default() 
+ * frequencies, and are scaled by their drivers at other levels. Dividers 
+ * folded at compile time from the static CLOCK_*_FREQ constants are only 
+ * correct at the default level, and are not to be used by drivers or the 
+ * application while scaling is enabled. 
+ */
+/**@{*/ 
+
+typedef struct CLOCK_NOTIFIER_t{
+    struct CLOCK_NOTIFIER_t * next;
+    uint8_t (* prepare) (void);
+    void (* retime) (void);
+}clock_notifier_t;
+
+/** Performance level table, provided by the application. */
+extern const clock_conf_t perf_levels[APP_PERF_NLEVELS];
+
+/**
+ * @brief Register a notifier for clock changes.
+ * @param notifier Pointer to the notifier, which should not go out of scope.
+ */
+void clock_register_notifier(clock_notifier_t * notifier);
+
+/**
+ * @brief Request a performance level on behalf of a client.
+ * @param client Client identifier.
+ * @param level Index into ::perf_levels. 0, the default level, 
+ *        withdraws the request.
+ * @return 1 if the resulting level has been applied, 0 if it is deferred.
+ */
+uint8_t perf_request(uint8_t client, uint8_t level);
+
+/**
+ * @brief Get the currently applied performance level.
+ * @return Index into ::perf_levels.
+ */
+static inline uint8_t perf_get_level(void);
+
+/**
+ * @brief Retry any deferred performance level change.
+ */
+void perf_reactor(void);
+
+/**
+ * @brief Get the duration of the last completed level transition.
+ * @return Time from the first `prepare` to the last `retime`, in 
+ *         microseconds.
+ * 
+ * Intended for characterizing transition latency on each platform, and for
+ * deciding whether scaling is worthwhile for a given burst length.
+ */
+static inline uint16_t perf_get_transition_us(void);
+
+/**@}*/ 
+
+#endif
+
 // Set up the implementation
 #include "uc/core_impl.h"
 
@@ -42,10 +42,13 @@
  * The application must ensure to exit the entropy accumulation mode after it
  * has sufficient entropy and before any major initialization steps are takem.
  * 
- * This layer should not and does not do any hashing or heavy computation. 
- * Using such mathematical means to generate a byte stream is left to the 
- * application layer, which may use whatever algorithms or libraries to 
- * provide a bulk pseudo-random stream if needed.
+ * The entropy accumulation mode itself does not do any hashing or heavy 
+ * computation. Where the application can afford it, the optional entropy 
+ * pool (APP_SUPPORT_ENTROPY_POOL) instead harvests entropy in the 
+ * background, without taking over any peripherals, and provides a bulk 
+ * random byte stream from a ChaCha20 based DRBG. Applications which do not 
+ * enable it may use whatever algorithms or libraries they wish to provide 
+ * a bulk pseudo-random stream.
  * 
  */
 
@@ -54,6 +57,28 @@
 
 #include "map.h"
 
+/**
+ * @name Entropy Whitening Options
+ * Whitening applied to raw samples by entropy_get_bytes(), selected by 
+ * APP_ENTROPY_WHITENING.
+ */
+/**@{*/ 
+/** \brief Raw sample bits are used as is. */
+#define ENTROPY_WHITEN_NONE         0
+/** \brief Von Neumann debiasing of raw sample bit pairs. */
+#define ENTROPY_WHITEN_VONNEUMANN   1
+/** \brief Each output bit is the XOR of APP_ENTROPY_XOR_FOLD raw sample bits. */
+#define ENTROPY_WHITEN_XOR          2
+
+#ifndef APP_ENTROPY_WHITENING
+    #define APP_ENTROPY_WHITENING   ENTROPY_WHITEN_VONNEUMANN
+#endif
+
+#ifndef APP_ENTROPY_XOR_FOLD
+    #define APP_ENTROPY_XOR_FOLD    4
+#endif
+/**@}*/ 
+
 /**
  * @name Entropy API Functions
  * 
@@ -87,6 +112,60 @@ void entropy_init(void);
  */
 uint8_t entropy_get_byte(void);
 
+/**
+ * @brief Get a block of entropy.
+ * @param buffer Pointer to the buffer to fill.
+ * @param len Number of bytes required.
+ * @return Number of bytes written. This is less than `len` only if a 
+ *         health test failed.
+ * 
+ * Like entropy_get_byte(), this is a blocking call and is only to be used 
+ * in the entropy accumulation mode. It collects raw samples from the 
+ * source continuously for the whole block rather than restarting for each 
+ * byte, whitens them as per APP_ENTROPY_WHITENING, and runs the on-line 
+ * repetition count and adaptive proportion tests on the raw samples. On a 
+ * health test failure, collection stops and the failure is counted in the 
+ * statistics. 
+ * 
+ * entropy_get_byte() is unchanged and does not run these tests, since it 
+ * has no way to report a failure. Applications which need health tested 
+ * entropy should use this function instead, even for a single byte. 
+ * 
+ * @see entropy_get_stats()
+ */
+uint8_t entropy_get_bytes(uint8_t * buffer, uint8_t len);
+
+/**
+ * Entropy source statistics, accumulated since entropy_init(). 
+ * 
+ * `min_entropy` is the estimated min-entropy per raw sample, in bits as 
+ * Q8, from the frequency of the most common raw sample value. 
+ * 
+ * Since the accumulation mode may take over the clocks that system time 
+ * depends on, elapsed time is not reported in microseconds. It is instead
+ * reported as `elapsed_cycles`, counts of the core clock, which is not 
+ * taken over. The implementation counts them from the platform's cycle 
+ * counter, or from the fixed cycle cost of its sampling loop where there 
+ * is none. uC_ENTROPY_CORE_FREQ, from the map, gives the core clock 
+ * frequency during accumulation, and the output rate in bytes/sec is 
+ * `bytes * uC_ENTROPY_CORE_FREQ / elapsed_cycles`. Together, these allow 
+ * the accumulation time to be tuned for each platform.
+ */
+typedef struct ENTROPY_STATS_t{
+    uint32_t samples;
+    uint32_t bytes;
+    uint32_t elapsed_cycles;
+    uint16_t min_entropy;
+    uint16_t rct_failures;
+    uint16_t apt_failures;
+}entropy_stats_t;
+
+/**
+ * @brief Read the entropy source statistics.
+ * @param stats Pointer to the structure the statistics are copied into.
+ */
+void entropy_get_stats(entropy_stats_t * stats);
+
 /**
  * @brief Leave the entropy accumulation mode. 
  * 
@@ -102,6 +181,79 @@ uint8_t entropy_get_byte(void);
 void entropy_deinit(void);
 /**@}*/ 
 
+#if APP_SUPPORT_ENTROPY_POOL
+
+/**
+ * @name Entropy Pool API Functions
+ * 
+ * The entropy pool is fed opportunistically with samples from sources 
+ * which are available during normal operation, without reconfiguring them.
+ * When the pool is enabled, the HAL drivers feed it from their interrupt 
+ * handlers : the LSBs of ADC conversion results, the LSBs of timer captures,
+ * and the count of a timer on a different clock source than the core, 
+ * sampled at each software timer expiry for clock jitter. The application 
+ * may feed it from other sources as well. 
+ * 
+ * Each source has its own continuous health tests, a repetition count test 
+ * and an adaptive proportion test, on its raw samples. A source failing 
+ * either is excluded from the pool until the pool is reinitialized. 
+ * Samples which pass are mixed into the pool, and credited with the 
+ * per-source min-entropy estimate given by the implementation. 
+ * 
+ * Once the pool has accumulated at least 256 bits, the DRBG can be seeded 
+ * from it, and reseeded later whenever the pool is full again. The DRBG is 
+ * ChaCha20 keyed from the pool, and generates output a 64 byte block at a 
+ * time, rekeying itself after each request for backtracking resistance. 
+ */
+/**@{*/ 
+
+#define ENTROPY_SOURCE_CLOCK        0
+#define ENTROPY_SOURCE_ADC          1
+#define ENTROPY_SOURCE_CAPTURE      2
+#define ENTROPY_SOURCE_APP          3
+
+/**
+ * @brief Initialize the entropy pool and clear the health test state.
+ */
+void entropy_pool_init(void);
+
+/**
+ * @brief Feed a raw sample into the entropy pool. Safe to call from ISRs.
+ * @param source Source identifier, one of the ENTROPY_SOURCE_* defines.
+ * @param sample Raw sample from the source.
+ */
+static inline void entropy_pool_feed(uint8_t source, uint16_t sample);
+
+/**
+ * @brief Get the estimated entropy accumulated in the pool.
+ * @return Estimated min-entropy, in bits, upto the size of the pool.
+ */
+static inline uint16_t entropy_pool_bits(void);
+
+/**
+ * @brief Get the sources which have failed their health tests.
+ * @return Mask of failed sources, with bit n for source n.
+ */
+static inline uint8_t entropy_pool_failed(void);
+
+/**
+ * @brief Seed or reseed the DRBG from the pool.
+ * @return 1 for success, 0 if the pool does not yet hold 256 bits.
+ */
+uint8_t drbg_reseed(void);
+
+/**
+ * @brief Get random bytes from the DRBG.
+ * @param buffer Pointer to the buffer to fill.
+ * @param len Number of bytes required.
+ * @return 1 for success, 0 if the DRBG has not yet been seeded.
+ */
+uint8_t drbg_get_bytes(uint8_t * buffer, uint16_t len);
+
+/**@}*/ 
+
+#endif
+
 // Set up the implementation
 #include "uc/entropy_impl.h"
 
@@ -0,0 +1,42 @@
+/* 
+ * Copyright (c)
+ *   (c) 2026 Chintalagiri Shashank, Quazar Technologies Pvt. Ltd.
+ *  
+ * This file is part of
+ * Embedded bootstraps : hal-uC
+ * 
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ */
+
+/**
+ * @file hal_uc_iovec.h
+ * @brief Scatter / gather buffer descriptors
+ *
+ * Buffer descriptors used by the vectored I/O functions of the byte stream
+ * interfaces, such as uart_writev() and usbcdc_writev(), so that protocol 
+ * layers can send a header and a payload from separate buffers without 
+ * first copying them together.
+ */
+
+#ifndef HAL_UC_IOVEC_H
+#define HAL_UC_IOVEC_H
+
+#include <platform/types.h>
+
+typedef struct HAL_IOVEC_t{
+    const uint8_t * base;
+    uint8_t len;
+}hal_iovec_t;
+
+#endif
@@ -0,0 +1,215 @@
+/* 
+ * Copyright (c)
+ *   (c) 2026 Chintalagiri Shashank, Quazar Technologies Pvt. Ltd.
+ *  
+ * This file is part of
+ * Embedded bootstraps : hal-uC
+ * 
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ */
+
+/**
+ * @file hal_uc_mux.h
+ * @brief Logical channel multiplexer over a pluggable transport
+ *
+ * This file provides upto APP_MUX_NCHANNELS logical channels, such as logs, 
+ * RPC and bulk firmware data, over a single pluggable transport, replacing 
+ * ad-hoc serialization using the transport's locks. 
+ * 
+ * Data on each channel is sent as frames of upto APP_MUX_MAX_PAYLOAD bytes. 
+ * Each frame is laid out as follows, with multi-byte fields little endian : 
+ * 
+ *  - Sync (uint8) : MUX_SYNC.
+ *  - Channel and flags (uint8) : channel number in the low nibble, 
+ *    MUX_FLAG_* in the high nibble.
+ *  - Payload length (uint8).
+ *  - Offset (uint16) : for data frames, the channel's running byte count, 
+ *    modulo 2^16, at the first byte of the payload. 
+ *  - Header check (uint8) : CRC-8 (polynomial 0x07, initial value 0) over 
+ *    the channel and flags, length and offset bytes.
+ *  - Payload, if the length is non-zero.
+ *  - Payload check (uint8), if the length is non-zero : CRC-8 as above, 
+ *    over the payload.
+ * 
+ * The transport is not assumed to be lossless. A UART can drop or corrupt 
+ * bytes on overrun or line noise. The receiver therefore hunts for frames : 
+ * it discards bytes until it sees MUX_SYNC, and then accepts the header 
+ * only if its check matches, the channel is below APP_MUX_NCHANNELS and 
+ * the length is at most APP_MUX_MAX_PAYLOAD. If the header is rejected, 
+ * only the sync byte is discarded, and hunting resumes from the byte after 
+ * it, so a sync value appearing within a payload cannot hold off 
+ * resynchronization. A frame whose payload check fails is discarded whole, 
+ * and the receiver goes back to hunting. 
+ * 
+ * Lost frames are detected from the offset. When a data frame's offset is 
+ * ahead of what the receiver expects on the channel, the missing bytes are 
+ * counted as lost in the channel's statistics, the next frame delivered to 
+ * the callback is flagged with MUX_FLAG_GAP, which is only ever reported 
+ * locally and never sent, and the missing bytes are 
+ * treated as consumed for flow control. Retransmission, where needed, is 
+ * left to the protocol on the channel. 
+ * 
+ * The channel number is also its priority, with 0 being the most urgent. 
+ * Between frames, the multiplexer always sends from the most urgent channel 
+ * with data queued and credit available. A long bulk transfer is therefore 
+ * preempted at the next frame boundary by a higher priority frame, and 
+ * the worst case delay to an urgent frame is one maximum sized frame. 
+ * 
+ * Flow control is credit based, per channel. Frames with MUX_FLAG_CREDIT 
+ * set carry no payload, and their offset field is the limit up to which the 
+ * receiver will accept data on that channel, as a running byte count 
+ * modulo 2^16. The receiver advances the limit as the application 
+ * consumes received data. Since each credit frame carries the absolute 
+ * limit, a lost or rejected credit frame is superseded by the next one. A 
+ * sender which has been stalled for credit for APP_MUX_CREDIT_TIMEOUT_MS 
+ * sends a data frame with no payload as a probe, which the receiver always 
+ * answers with a credit frame. Each side starts with a limit of 
+ * APP_MUX_INITIAL_CREDIT bytes on each channel.
+ */
+
+#ifndef HAL_UC_MUX_H
+#define HAL_UC_MUX_H
+
+#include <platform/transport.h>
+#include <platform/types.h>
+#include "map.h"
+
+#ifndef APP_MUX_NCHANNELS
+    #define APP_MUX_NCHANNELS       4
+#endif
+
+#ifndef APP_MUX_MAX_PAYLOAD
+    #define APP_MUX_MAX_PAYLOAD     64
+#endif
+
+#ifndef APP_MUX_INITIAL_CREDIT
+    #define APP_MUX_INITIAL_CREDIT  128
+#endif
+
+#ifndef APP_MUX_CREDIT_TIMEOUT_MS
+    #define APP_MUX_CREDIT_TIMEOUT_MS   100
+#endif
+
+#if APP_MUX_NCHANNELS > 16
+    #error "APP_MUX_NCHANNELS must fit in the 4 bit channel field"
+#endif
+
+#if APP_MUX_MAX_PAYLOAD > 255
+    #error "APP_MUX_MAX_PAYLOAD must fit in the uint8 length field"
+#endif
+
+#if !APP_SUPPORT_SWTIMER
+    #error "The multiplexer requires APP_SUPPORT_SWTIMER for credit timeouts"
+#endif
+
+#if !APP_SUPPORT_MONOTONIC
+    #error "The multiplexer requires APP_SUPPORT_MONOTONIC for latency counters"
+#endif
+
+#define MUX_SYNC                    0xA5
+#define MUX_HEADER_SIZE             6
+
+#define MUX_FLAG_CREDIT             0x10
+#define MUX_FLAG_EOM                0x20
+#define MUX_FLAG_GAP                0x40
+
+/**
+ * @name Multiplexer API Functions
+ * 
+ */
+/**@{*/ 
+
+typedef void (* mux_rx_callback_t) (uint8_t channel, uint8_t * data, 
+                                    uint8_t len, uint8_t flags);
+
+typedef struct MUX_CHANNEL_STATS_t{
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint16_t tx_frames;
+    uint16_t credit_stalls;
+    uint16_t rx_errors;
+    uint32_t rx_lost_bytes;
+    uint16_t max_latency_us;
+}mux_channel_stats_t;
+
+/**
+ * @brief Initialize the multiplexer over a transport interface.
+ * @param transport Pointer to the transport to use.
+ * @param intfnum Identifier of the interface of the transport.
+ */
+void mux_init(const pluggable_transport_t * transport, uint8_t intfnum);
+
+/**
+ * @brief Register the receive callback for a channel.
+ * @param channel Channel number.
+ * @param callback Function called with each received frame's payload. 
+ *        `flags` has MUX_FLAG_EOM set on the last frame of a message, and 
+ *        MUX_FLAG_GAP set if data was lost on the channel just before 
+ *        this frame.
+ */
+void mux_set_rx_callback(uint8_t channel, mux_rx_callback_t callback);
+
+/**
+ * @brief Queue a message for transmission on a channel.
+ * @param channel Channel number.
+ * @param data Pointer to the message. Must remain valid until sent.
+ * @param len Length of the message.
+ * @return 1 if queued, 0 if the channel's queue is full.
+ * 
+ * The message is split into frames as needed, the last of which is 
+ * marked with MUX_FLAG_EOM.
+ */
+uint8_t mux_send(uint8_t channel, const uint8_t * data, uint16_t len);
+
+/**
+ * @brief Return credit for data received on a channel.
+ * @param channel Channel number.
+ * @param len Number of received bytes the application has finished with.
+ */
+void mux_consume(uint8_t channel, uint16_t len);
+
+/**
+ * @brief Check whether everything queued on a channel has been sent.
+ * @param channel Channel number.
+ * @return 1 if the channel's queue is empty, 0 otherwise.
+ */
+static inline uint8_t mux_tx_done(uint8_t channel);
+
+/**
+ * @brief Move data between the channels and the transport.
+ * 
+ * Sends frames while the transport can accept them, and parses received 
+ * frames. Should be run from the main loop, or as a scheduler task 
+ * posted from the transport's interrupts. 
+ */
+void mux_reactor(void);
+
+/**
+ * @brief Get a channel's counters.
+ * @param channel Channel number.
+ * 
+ * Latency is from mux_send() to the message's last frame being written to 
+ * the transport. Together with the byte counts, these serve to benchmark 
+ * the multiplexer over each transport. `rx_errors` counts rejected headers
+ * and failed payload checks, and `rx_lost_bytes` the data bytes found 
+ * missing from the offsets. 
+ */
+static inline const mux_channel_stats_t * mux_get_stats(uint8_t channel);
+
+/**@}*/ 
+
+// Set up the implementation
+#include "uc/mux_impl.h"
+
+#endif
@@ -0,0 +1,140 @@
+/* 
+ * Copyright (c)
+ *   (c) 2026 Chintalagiri Shashank, Quazar Technologies Pvt. Ltd.
+ *  
+ * This file is part of
+ * Embedded bootstraps : hal-uC
+ * 
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ */
+
+/**
+ * @file hal_uc_profile.h
+ * @brief HAL for cycle profiling zones
+ *
+ * This file provides lightweight profiling of code zones using a free 
+ * running timer interface. The interface is selected by 
+ * uC_PROFILE_TIMER_INTFNUM in the map, and should be run in CONTINUOUS 
+ * mode from the core clock with no prescaling, so that timer counts are 
+ * core cycles. 
+ * 
+ * Zones are identified by small integers, upto APP_PROFILE_NZONES, which the 
+ * application allocates. For each zone, the number of calls and the minimum, 
+ * maximum and total cycles between PROFILE_BEGIN() and PROFILE_END() are 
+ * recorded into a static table. A zone's begin costs one timer read and a 
+ * store. Its end costs a timer read and the table updates. Differences are 
+ * 16 bit, so individual zone executions should be shorter than 65536 cycles. 
+ * Different zones may nest, but a zone may not be re-entered before it ends.
+ * Totals are kept in 64 bits, so they do not wrap in any practical run, 
+ * and `total / calls` remains a valid mean. 
+ * 
+ * When APP_SUPPORT_PROFILING is not set, the macros expand to nothing. 
+ * 
+ * The table can be streamed over any pluggable transport using 
+ * profile_dump(). The format, all little endian, is : 
+ * 
+ *  - Header : 'P' 'Z', version (uint8, 1), zone count (uint8), 
+ *             timer frequency in Hz (uint32).
+ *  - Zone records, one for each zone with a non-zero call count : 
+ *             zone (uint8), calls (uint32), min (uint16), max (uint16),
+ *             total (uint64).
+ * 
+ * The zone count in the header is the number of records which follow.
+ */
+
+#ifndef HAL_UC_PROFILE_H
+#define HAL_UC_PROFILE_H
+
+#include <platform/transport.h>
+#include <platform/types.h>
+#include "map.h"
+
+#if APP_SUPPORT_PROFILING
+
+#ifndef APP_PROFILE_NZONES
+    #define APP_PROFILE_NZONES      16
+#endif
+
+#if APP_PROFILE_NZONES > 255
+    #error "APP_PROFILE_NZONES must fit in the uint8 zone count of the dump"
+#endif
+
+#define PROFILE_DUMP_VERSION        1
+
+/**
+ * @name Profiling API Functions
+ * 
+ */
+/**@{*/ 
+
+typedef struct PROFILE_ZONE_t{
+    uint16_t start;
+    uint16_t min;
+    uint16_t max;
+    uint32_t calls;
+    uint64_t total;
+}profile_zone_t;
+
+extern profile_zone_t profile_zones[APP_PROFILE_NZONES];
+
+/**
+ * @brief Initialize the profiling timer and clear the zone table.
+ */
+void profile_init(void);
+
+/**
+ * @brief Clear the zone table.
+ */
+void profile_clear(void);
+
+/**
+ * @brief Mark the beginning of a zone execution.
+ * @param zone Zone identifier.
+ */
+static inline void profile_zone_begin(uint8_t zone);
+
+/**
+ * @brief Mark the end of a zone execution and record it.
+ * @param zone Zone identifier.
+ */
+static inline void profile_zone_end(uint8_t zone);
+
+/**
+ * @brief Stream the zone table over a pluggable transport.
+ * @param transport Pointer to the transport to use.
+ * @param intfnum Identifier of the interface of the transport.
+ * @return Number of bytes written.
+ * 
+ * The table is read zone by zone without stopping profiling, so records 
+ * of zones which are active while the dump is in progress may be from 
+ * slightly different instants. 
+ */
+uint16_t profile_dump(const pluggable_transport_t * transport, uint8_t intfnum);
+
+#define PROFILE_BEGIN(zone)     profile_zone_begin(zone)
+#define PROFILE_END(zone)       profile_zone_end(zone)
+
+/**@}*/ 
+
+#else
+
+#define PROFILE_BEGIN(zone)
+#define PROFILE_END(zone)
+
+#endif
+
+// Set up the implementation
+#include "uc/profile_impl.h"
+
+#endif
@@ -0,0 +1,133 @@
+/* 
+ * Copyright (c)
+ *   (c) 2026 Chintalagiri Shashank, Quazar Technologies Pvt. Ltd.
+ *  
+ * This file is part of
+ * Embedded bootstraps : hal-uC
+ * 
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ */
+
+/**
+ * @file hal_uc_sched.h
+ * @brief HAL for the cooperative event scheduler
+ *
+ * This file provides an event driven replacement for the usual round robin 
+ * main loop which calls spi_reactor(), checks usb_status(), polls 
+ * uart_population_rxb() and so on regardless of whether there is any work. 
+ * 
+ * Each task is a reactor function with a task number, upto APP_SCHED_NTASKS. 
+ * The task number is also its priority, with 0 being the most urgent. ISRs 
+ * (and other tasks) signal a task by posting to it, which sets a single 
+ * pending bit with atomic_fetch_or_u16() (or the 32 bit variant, for more 
+ * than 16 tasks) from core.h. The scheduler runs the most urgent pending 
+ * task, clearing its bit first with atomic_fetch_and_u16(), so a post 
+ * arriving while the task runs will run it again. Posts to a task which is already pending 
+ * are merged. Tasks run to completion and are never preempted by other 
+ * tasks. 
+ * 
+ * When nothing is pending, the scheduler sleeps using power_idle(). It 
+ * checks the pending bits within critical_enter(), and calls power_idle() 
+ * from within the same critical section, which unmasks interrupts only 
+ * as the core enters sleep, so a post from an ISR can not be missed. 
+ * 
+ * The HAL drivers post to the task numbers given by the map's 
+ * `uC_SCHED_TASK_*` defines, if the application provides them, from their 
+ * interrupt handlers. 
+ */
+
+#ifndef HAL_UC_SCHED_H
+#define HAL_UC_SCHED_H
+
+#include <platform/types.h>
+#include "map.h"
+
+#ifndef APP_SCHED_NTASKS
+    #define APP_SCHED_NTASKS        8
+#endif
+
+#if APP_SUPPORT_SCHED_STATS && !APP_SUPPORT_MONOTONIC
+    #error "APP_SUPPORT_SCHED_STATS requires APP_SUPPORT_MONOTONIC"
+#endif
+
+/**
+ * @name Scheduler API Functions
+ * 
+ */
+/**@{*/ 
+
+/**
+ * Per task runtime accounting, available when APP_SUPPORT_SCHED_STATS is 
+ * set. Times are in counts of the monotonic clock. Latency is from the 
+ * first post which made the task pending to the start of its reactor, and 
+ * is the dispatch latency of the scheduler under the actual load. 
+ */
+typedef struct SCHED_TASK_STATS_t{
+    uint32_t runs;
+    uint16_t max_runtime;
+    uint32_t total_runtime;
+    uint16_t max_latency;
+    uint32_t total_latency;
+}sched_task_stats_t;
+
+/**
+ * @brief Initialize the scheduler. 
+ */
+void sched_init(void);
+
+/**
+ * @brief Register a task's reactor.
+ * @param task Task number, which is also its priority.
+ * @param reactor Reactor function to run when the task is signalled.
+ */
+void sched_register(uint8_t task, void (* reactor) (void));
+
+/**
+ * @brief Signal a task. Safe to call from ISRs.
+ * @param task Task number.
+ */
+static inline void sched_post(uint8_t task);
+
+/**
+ * @brief Run the most urgent pending task, if any.
+ * @return 1 if a task was run, 0 if none were pending.
+ */
+uint8_t sched_run_once(void);
+
+/**
+ * @brief Run tasks as they are signalled, sleeping when idle. 
+ * 
+ * Does not return.
+ */
+void sched_run(void);
+
+#if APP_SUPPORT_SCHED_STATS
+/**
+ * @brief Get a task's runtime accounting.
+ * @param task Task number.
+ */
+static inline const sched_task_stats_t * sched_get_stats(uint8_t task);
+
+/**
+ * @brief Reset the runtime accounting of all tasks.
+ */
+void sched_clear_stats(void);
+#endif
+
+/**@}*/ 
+
+// Set up the implementation
+#include "uc/sched_impl.h"
+
+#endif
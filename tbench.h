@@ -0,0 +1,165 @@
+/* 
+ * Copyright (c)
+ *   (c) 2026 Chintalagiri Shashank, Quazar Technologies Pvt. Ltd.
+ *  
+ * This file is part of
+ * Embedded bootstraps : hal-uC
+ * 
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>. 
+ */
+
+/**
+ * @file hal_uc_tbench.h
+ * @brief Pluggable transport benchmark
+ *
+ * This file provides a benchmark which drives any pluggable transport, such 
+ * as `ptransport_uart` or `ptransport_usbcdc`, with a configurable pattern 
+ * of messages, and measures it. The same benchmark runs unchanged against 
+ * a device or against a host implementation of the transport. 
+ * 
+ * Patterns : 
+ * 
+ *  - Stream : messages are sent back to back. The peer validates and 
+ *    counts them, and sends nothing back.
+ *  - Echo : each message is sent, and the same bytes are expected back. 
+ *  - Request / Response : each message is sent, and a response of the 
+ *    configured length is expected back before the next is sent. 
+ * 
+ * One end runs tbench_run(), as the initiator, and the other runs 
+ * tbench_serve() with the same configuration, as the responder or sink. 
+ * Either end may be the device or a host implementation. 
+ * 
+ * Messages carry a sequence number and a known fill, and every receiving 
+ * end checks them. The responder counts gaps in the sequence as dropped, 
+ * and fill mismatches as corrupted, in its own results. This is the only 
+ * place stream drops can be counted. For echo and request / response, 
+ * the initiator also checks what comes back, and counts responses which 
+ * never arrive within the timeout as dropped, and bad ones as corrupted. 
+ * The two sets of results together separate losses on the way out from 
+ * losses on the way back. 
+ * 
+ * Latency, for patterns which have a response, is from the start of the 
+ * write to the complete response having been read, and is collected into a
+ * log2 histogram from which percentiles are estimated. Cycles per byte are 
+ * the core cycles spent inside the transport functions, as measured on the 
+ * profiling timer, divided by the bytes moved. The profiling timer is 
+ * therefore required, and the `cycles` result is only meaningful where 
+ * that timer counts core cycles. This isolates the per byte 
+ * cost of functions like uart_vprintf(), uart_write() and usbcdc_write() 
+ * from the time spent waiting on the link. 
+ * 
+ * The results can be emitted as a single JSON object over any transport, 
+ * for regression tracking.
+ */
+
+#ifndef HAL_UC_TBENCH_H
+#define HAL_UC_TBENCH_H
+
+#include <platform/transport.h>
+#include <platform/types.h>
+#include "map.h"
+
+#if !APP_SUPPORT_PROFILING
+    #error "The transport benchmark requires APP_SUPPORT_PROFILING for cycle counts"
+#endif
+
+#define TBENCH_PATTERN_STREAM       0
+#define TBENCH_PATTERN_ECHO         1
+#define TBENCH_PATTERN_REQRESP      2
+
+#define TBENCH_HIST_BINS            16
+
+/**
+ * @name Transport Benchmark API Functions
+ * 
+ */
+/**@{*/ 
+
+typedef struct TBENCH_CONF_t{
+    uint8_t pattern;
+    uint8_t msglen;
+    uint8_t resplen;
+    uint16_t count;
+}tbench_conf_t;
+
+typedef struct TBENCH_RESULT_t{
+    uint32_t bytes;
+    uint32_t elapsed_us;
+    uint32_t cycles;
+    uint16_t messages;
+    uint16_t dropped;
+    uint16_t corrupted;
+    uint16_t latency_hist[TBENCH_HIST_BINS];
+}tbench_result_t;
+
+/**
+ * @brief Run the benchmark over a transport interface.
+ * @param transport Pointer to the transport under test.
+ * @param intfnum Identifier of the interface of the transport.
+ * @param conf Pointer to the benchmark configuration.
+ * @param result Pointer to the structure the results are written to.
+ * @return 1 if the run completed, 0 if it was abandoned on a timeout.
+ */
+uint8_t tbench_run(const pluggable_transport_t * transport, uint8_t intfnum, 
+                   const tbench_conf_t * conf, tbench_result_t * result);
+
+/**
+ * @brief Serve the peer end of a benchmark over a transport interface.
+ * @param transport Pointer to the transport under test.
+ * @param intfnum Identifier of the interface of the transport.
+ * @param conf Pointer to the benchmark configuration, which must match 
+ *        the initiator's.
+ * @param result Pointer to the structure the responder's own results are 
+ *        written to.
+ * @return 1 if the run completed, 0 if it was abandoned on a timeout.
+ * 
+ * Receives `conf->count` messages, validating sequence and fill, and 
+ * echoes each message or sends a `conf->resplen` byte response as the 
+ * pattern requires. `messages`, `bytes`, `dropped` and `corrupted` are 
+ * counted on received data, and `cycles` on time spent in the transport 
+ * functions for both directions. The latency histogram is not used.
+ * Returns once the last sequence number has been seen, or when no message 
+ * has arrived within the timeout.
+ */
+uint8_t tbench_serve(const pluggable_transport_t * transport, uint8_t intfnum, 
+                     const tbench_conf_t * conf, tbench_result_t * result);
+
+/**
+ * @brief Estimate a latency percentile from a result's histogram.
+ * @param result Pointer to the benchmark results.
+ * @param percentile Percentile, 1 to 99.
+ * @return Upper bound of the histogram bin containing the percentile, 
+ *         in microseconds.
+ */
+uint32_t tbench_percentile(const tbench_result_t * result, uint8_t percentile);
+
+/**
+ * @brief Write a benchmark configuration and its results as JSON.
+ * @param transport Pointer to the transport to write the report to.
+ * @param intfnum Identifier of the interface of the transport.
+ * @param name Name of the transport under test, for the report.
+ * @param conf Pointer to the benchmark configuration.
+ * @param result Pointer to the benchmark results.
+ * 
+ * The report contains the configuration, throughput in bytes/sec, the 
+ * 50th, 90th and 99th percentile latencies, cycles per byte as Q8, and the 
+ * drop and corruption counts. 
+ */
+void tbench_report_json(const pluggable_transport_t * transport, uint8_t intfnum, 
+                        const char * name, const tbench_conf_t * conf, 
+                        const tbench_result_t * result);
+
+/**@}*/ 
+
+#endif
@@ -43,14 +43,17 @@
  * On MSP430, this implementation reserves channel 0 for setting the period (TOP), 
  * so you would normally use CH1+ for specialized uses. On platforms like the 
  * MSP430, this implementation has the unfortunate side effect of making CH0 
- * unusable as a PWM in cases where TOP need not be changed. Being able to switch 
- * the top interrupt to the overflow interrupt would be useful, if messy.
+ * unusable as a PWM in cases where TOP need not be changed. To recover CH0, the
+ * period can instead be fixed at MAX using timer_set_top_mode(), in which case
+ * the overflow interrupt takes the place of the top interrupt.
  * 
  * Supported configuration types :
  * 
  *     - LF Periodic Timer : UP, other channels can be used to relative phase shift.
  *     - Edge Counting : CONTINUOUS. all channels can be used to hook specific counts. 
  *     - PWM : UP/CONTINUOUS, other channels have duty cycle set by CHx CCR.
+ *     - Input Capture : CONTINUOUS, channels capture the count on input edges.
+ *                       Available when APP_SUPPORT_TIMER_CAPTURE is set.
  */
 
 // Initialize timer clock source, default prescaler.
@@ -80,6 +83,12 @@ static inline void timer_set_top(uint8_t intfnum, uint16_t top);
 // Get TOP for the timer.
 static inline uint16_t timer_get_top(uint8_t intfnum);
 
+#define TIMER_TOP_CH0           0
+#define TIMER_TOP_MAX           1
+
+// Select whether TOP is set by CH0 (default) or fixed at MAX, freeing CH0.
+static inline void timer_set_top_mode(uint8_t intfnum, uint8_t topmode);
+
 // Set output mode for the timer channel.
 static inline void timer_set_outmode_ch( uint8_t intfnum, uint8_t channel, uint8_t outmode);
 
@@ -95,6 +104,300 @@ static inline void timer_set_cmr_ch(uint8_t intfnum, uint8_t channel, uint16_t c
 // Get the channel compare match value.
 static inline uint16_t timer_get_cmr_ch(uint8_t intfnum, uint8_t channel);
 
+// Get the current timer count.
+static inline uint16_t timer_get_count(uint8_t intfnum);
+
+// Return 1 if the timer has overflowed and the interrupt has not yet been serviced.
+static inline uint8_t timer_get_overflow_pending(uint8_t intfnum);
+
+
+#if APP_SUPPORT_MONOTONIC
+
+/*
+ * Monotonic Clock
+ * 
+ * A 32/64 bit monotonic clock built by extending a 16 bit timer interface
+ * running in CONTINUOUS mode with a count of overflows maintained by the 
+ * overflow interrupt. The interface is selected by uC_MONOTONIC_TIMER_INTFNUM 
+ * and its count frequency, in Hz, is given by uC_MONOTONIC_TIMER_FREQ, both 
+ * from the map. 
+ * 
+ * Reads do not disable interrupts. Every read, from any context, is : 
+ * 
+ *  1. Read the overflow count.
+ *  2. Read the timer count, with timer_get_count().
+ *  3. Read the overflow flag, with timer_get_overflow_pending().
+ *  4. Read the overflow count again. If it differs from (1), the overflow 
+ *     interrupt ran in between, and the read is retried from (1).
+ *  5. If the flag read in (3) was set and the count read in (2) is in the 
+ *     lower half of the range (below 0x8000), the counter wrapped before 
+ *     (2) and the interrupt has not yet been serviced, so one is added to 
+ *     the overflow count. A count in the upper half was read before the 
+ *     wrap, and is used as is. 
+ * 
+ * Step (5) covers both the IRQ entry latency window, when the counter has 
+ * wrapped but the overflow ISR has not yet run, and reads from contexts 
+ * where the overflow interrupt cannot run at all, such as other ISRs. It 
+ * holds as long as the overflow interrupt is never held off for more than 
+ * half a timer period. The overflow handler must increment the overflow 
+ * count and clear the overflow flag together within critical_enter() / 
+ * critical_exit(), incrementing first. No reader, including a higher 
+ * priority ISR on a platform with nested interrupts, can then observe the 
+ * incremented count with the flag still set (which would count the 
+ * overflow twice), or the flag clear with the count not yet incremented. 
+ * On platforms where the flag is cleared by hardware on vector entry, the 
+ * handler must instead run at a priority no lower than that of any reader.
+ * 
+ * Conversion to microseconds uses multiplies and shifts, with the 
+ * multiplier folded at compile time from uC_MONOTONIC_TIMER_FREQ, which 
+ * must be above 244 Hz for MONOTONIC_US_MULT to fit in 32 bits at the 
+ * default shift. This is checked at preprocessing time for any shift. Rounding of the multiplier limits the error to one part 
+ * in (2 * MONOTONIC_US_MULT). 
+ * 
+ * The 32 bit conversion forms the 64 bit product `ticks * MONOTONIC_US_MULT`,
+ * which always fits, and shifts it down by MONOTONIC_US_SHIFT. The result 
+ * is valid for intervals upto 2^32 us, about 71 minutes. 
+ * 
+ * The 64 bit conversion splits ticks into 32 bit halves, `hi` and `lo`, 
+ * and computes 
+ * `((hi * MONOTONIC_US_MULT) << (32 - MONOTONIC_US_SHIFT)) + ((lo * MONOTONIC_US_MULT) >> MONOTONIC_US_SHIFT)`
+ * with each product in 64 bits. This is exactly the full product shifted 
+ * down, without forming it, and is valid for any interval whose result 
+ * fits in 64 bits of microseconds. There is no division in either path.
+ */
+
+#ifndef MONOTONIC_US_SHIFT
+    #define MONOTONIC_US_SHIFT      20
+#endif
+
+#if MONOTONIC_US_SHIFT > 32
+    #error "MONOTONIC_US_SHIFT must not exceed 32"
+#endif
+
+#if ((1000000ULL << MONOTONIC_US_SHIFT) / uC_MONOTONIC_TIMER_FREQ) > 0xFFFFFFFFULL
+    #error "uC_MONOTONIC_TIMER_FREQ too low for MONOTONIC_US_SHIFT, MONOTONIC_US_MULT overflows"
+#endif
+
+#define MONOTONIC_US_MULT   ((uint32_t)(((1000000ULL << MONOTONIC_US_SHIFT) + \
+                                         (uC_MONOTONIC_TIMER_FREQ / 2)) / \
+                                        uC_MONOTONIC_TIMER_FREQ))
+
+// Initialize the timer interface for the monotonic clock and start it.
+void monotonic_init(void);
+
+// Get the monotonic clock, in timer counts, truncated to 32 bits.
+static inline uint32_t monotonic_get(void);
+
+// Get the monotonic clock, in timer counts.
+static inline uint64_t monotonic_get64(void);
+
+// Convert an interval in timer counts to microseconds.
+static inline uint32_t monotonic_ticks_to_us(uint32_t ticks);
+
+// Convert an interval in timer counts to microseconds.
+static inline uint64_t monotonic_ticks_to_us64(uint64_t ticks);
+
+// Overflow interrupt hook. Called from the timer's handler in timer_handlers.h.
+static inline void monotonic_overflow_handler(void);
+
+#endif
+
+
+#if APP_SUPPORT_TIMER_STAGED
+
+/*
+ * Staged Updates
+ * 
+ * Compare values for several channels, and optionally TOP, are written to 
+ * shadow storage and applied together at the next period boundary, so that 
+ * a set of related PWM duty cycles (the three phases of a bridge, say) never 
+ * straddles a period. 
+ * 
+ * Where the channels have hardware preload (compare latch) registers, the 
+ * implementation uses them, and the values are transferred by the hardware 
+ * at the boundary. Otherwise, the commit is applied from the top interrupt, 
+ * or the overflow interrupt when TIMER_TOP_MAX is in use, which is enabled 
+ * by the implementation for the purpose. Values to be applied from the ISR 
+ * should leave enough margin from the boundary to cover the IRQ latency.
+ * 
+ * Stage functions should not be called while a commit is pending. 
+ */
+
+// Stage a compare match value for the channel.
+static inline void timer_stage_cmr_ch(uint8_t intfnum, uint8_t channel, uint16_t cm);
+
+// Stage a new TOP for the timer.
+static inline void timer_stage_top(uint8_t intfnum, uint16_t top);
+
+// Commit all staged values, to be applied together at the next period boundary.
+static inline void timer_commit_staged(uint8_t intfnum);
+
+// Return 1 if a commit has not yet been applied, 0 otherwise.
+static inline uint8_t timer_staged_pending(uint8_t intfnum);
+
+#endif
+
+#if APP_SUPPORT_TIMER_CAPTURE
+
+/*
+ * Input Capture
+ * 
+ * Captured counts are pushed by the channel's capture ISR into an application
+ * provided ring buffer, whose size must be a power of two. When the buffer 
+ * is full, new captures are dropped and counted as overruns. Where the 
+ * platform can move captures by DMA, the implementation may do so instead 
+ * of taking an interrupt per edge. 
+ * 
+ * When capturing on both edges, the polarity of each capture is recorded 
+ * alongside it, in an application provided bitmap with one bit per buffer 
+ * entry, set for a rising edge. The ISR takes the polarity from the 
+ * channel's synchronized input level at the time of capture. The bitmap 
+ * may be left null when capturing on a single edge. 
+ * 
+ * The timer should be run in CONTINUOUS mode. Differences between captures 
+ * are computed modulo 2^16, so the signal period must be shorter than one 
+ * timer overflow at the chosen prescaler. 
+ */
+
+#define TIMER_CAPTURE_RISING    1
+#define TIMER_CAPTURE_FALLING   2
+#define TIMER_CAPTURE_BOTH      3
+
+typedef struct TIMER_CAPTURE_BUF_t{
+    uint16_t * buffer;
+    uint8_t * edges;
+    uint16_t mask;
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile uint16_t overruns;
+}timer_capture_buf_t;
+
+// Configure the channel for input capture on the given edge(s) into the buffer.
+// Use timer_enable_int_ch() and timer_disable_int_ch() to start and stop capture.
+void timer_setup_capture_ch(uint8_t intfnum, uint8_t channel, uint8_t edge, 
+                            timer_capture_buf_t * cbuf);
+
+// Get the number of captures waiting in the channel's buffer.
+static inline uint16_t timer_capture_population(uint8_t intfnum, uint8_t channel);
+
+// Read upto len captures from the channel's buffer. Returns the number read.
+// If edges is not null, capture n's polarity is written to bit (n % 8) of 
+// edges[n / 8], set for rising. The edges buffer must hold (len + 7) / 8 bytes.
+static inline uint16_t timer_capture_read(uint8_t intfnum, uint8_t channel, 
+                                          uint16_t * buffer, uint8_t * edges, 
+                                          uint16_t len);
+
+// Discard all captures waiting in the channel's buffer.
+static inline void timer_capture_discard(uint8_t intfnum, uint8_t channel);
+
+/*
+ * Capture batch helpers. These operate on a batch of consecutive captures as 
+ * read out using timer_capture_read(), and perform a single division per 
+ * batch rather than one per edge. 
+ * 
+ * For duty cycle, the batch should be from a channel capturing on both edges,
+ * along with its polarity bitmap. The helper skips to the first rising 
+ * edge, and uses only rising - falling - rising triples whose polarities 
+ * alternate as they should. Triples broken by a dropped capture are 
+ * skipped rather than measured inverted. Since the period helpers cannot 
+ * detect drops, callers should check `overruns` and discard any batch 
+ * read across an increase in it.
+ */
+
+// Mean period over the batch, in timer counts, as Q24.8.
+uint32_t timer_capture_period(const uint16_t * captures, uint16_t len);
+
+// Mean frequency over the batch, in Hz, given the timer count frequency.
+uint32_t timer_capture_frequency(const uint16_t * captures, uint16_t len, 
+                                 uint32_t timer_freq);
+
+// Mean duty cycle over the batch as a fraction of 0xFFFF. 0 if no valid triple.
+uint16_t timer_capture_duty(const uint16_t * captures, const uint8_t * edges, 
+                            uint16_t len);
+
+#endif
+
+
+#if APP_SUPPORT_SWTIMER
+
+/*
+ * Software Timers
+ * 
+ * Any number of software timers multiplexed onto a single compare channel of 
+ * a single timer interface, which should be dedicated to this use and run in 
+ * CONTINUOUS mode. 
+ * 
+ * Timers are held in a hierarchical timing wheel of SWTIMER_WHEEL_LEVELS 
+ * levels of (1 << SWTIMER_WHEEL_BITS) slots each. Each slot is a doubly 
+ * linked list, so that starting and cancelling a timer are both O(1). Timers 
+ * in the outer levels cascade inward as their slot comes up. 
+ * 
+ * There is no fixed rate tick. The compare channel is programmed for the 
+ * nearest deadline among the occupied slots, or for the next slot boundary 
+ * which requires a cascade, whichever is earlier. With nothing pending, the 
+ * compare interrupt is left disabled. 
+ * 
+ * One software timer tick is (1 << SWTIMER_TICK_SHIFT) timer counts. The 
+ * longest timeout or period that can be used is SWTIMER_MAX_TICKS. 
+ * swtimer_start() refuses anything longer, returning 0 without starting 
+ * (or disturbing) the timer. Longer delays should be built by the 
+ * application from a periodic timer and a count. 
+ * 
+ * The defaults give 2^25 ticks of 16 counts each, which is about 9 minutes 
+ * at 16us resolution on a 1 MHz timer, or about 4.6 hours at 0.5ms 
+ * resolution on a 32768 Hz timer. Anything using this service, such as the
+ * power manager, the CDC coalescing and the watchdog supervisor, works 
+ * within that range. 
+ * 
+ * Callbacks are called from the compare interrupt handler and should be 
+ * kept short. They may start or cancel any timer, including their own. 
+ * Timer structures are owned by the application.
+ */
+
+#ifndef SWTIMER_WHEEL_BITS
+    #define SWTIMER_WHEEL_BITS      5
+#endif
+
+#ifndef SWTIMER_WHEEL_LEVELS
+    #define SWTIMER_WHEEL_LEVELS    5
+#endif
+
+#ifndef SWTIMER_TICK_SHIFT
+    #define SWTIMER_TICK_SHIFT      4
+#endif
+
+#define SWTIMER_MAX_TICKS   ((uint32_t)((1ULL << (SWTIMER_WHEEL_BITS * SWTIMER_WHEEL_LEVELS)) - 1))
+
+typedef struct SWTIMER_t{
+    struct SWTIMER_t * next;
+    struct SWTIMER_t * prev;
+    void (* callback) (struct SWTIMER_t *);
+    uint32_t expires;
+    uint32_t period;
+}swtimer_t;
+
+// Initialize the software timer service on the timer interface and channel.
+void swtimer_init(uint8_t intfnum, uint8_t channel);
+
+// Start a timer to expire after the given ticks. Restarts it if pending.
+// If period is non-zero, the timer is restarted with it on each expiry.
+// Returns 1 for success, 0 if ticks or period exceed SWTIMER_MAX_TICKS.
+static inline uint8_t swtimer_start(swtimer_t * timer, uint32_t ticks, uint32_t period);
+
+// Stop a pending timer. Has no effect on a timer which is not pending.
+static inline void swtimer_cancel(swtimer_t * timer);
+
+// Return 1 if the timer is pending, 0 otherwise.
+static inline uint8_t swtimer_pending(swtimer_t * timer);
+
+// Get the current software timer time, in ticks.
+static inline uint32_t swtimer_now(void);
+
+// Get the number of ticks until the nearest deadline, or 0xFFFFFFFF if none.
+static inline uint32_t swtimer_next_deadline(void);
+
+#endif
+
 #endif
 
 #include "uc/timer_impl.h"
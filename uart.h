@@ -36,6 +36,7 @@
 #include <stdarg.h>
 #include <platform/transport.h>
 #include <platform/types.h>
+#include "iovec.h"
 #include "map.h"
 
 #ifdef uC_INCLUDE_UART_IFACE
@@ -160,6 +161,70 @@ extern uint16_t * uart0_overrun_counter;
 extern uint16_t * uart1_overrun_counter;
 /**@}*/ 
 
+/**
+ * @name Zero-Copy and Vectored UART API Functions
+ * 
+ * Reserve / commit and peek / consume access directly into the 
+ * implementation's transmit and receive buffers, and vectored writes, 
+ * so that protocol layers need not copy each message through an 
+ * intermediate buffer. 
+ * 
+ * Since the buffers are typically rings, reserve and peek return only the 
+ * contiguous region available at the current position. A caller needing 
+ * more should commit or consume what it got and then call again. 
+ * 
+ * As with uart_write(), TX functions should be used with a held lock and 
+ * its token, and the application must subsequently trigger or flush 
+ * transmission. 
+ */
+/**@{*/ 
+
+/**
+ * @brief Reserve contiguous space in the transmit buffer.
+ * @param intfnum Identifier of the UART interface.
+ * @param ptr Set to the start of the reserved space.
+ * @param token Token against which the buffer lock is held.
+ * @return Number of bytes which may be written at `ptr`. 0 for error.
+ */
+static inline uint8_t uart_tx_reserve(uint8_t intfnum, uint8_t ** ptr, uint8_t token);
+
+/**
+ * @brief Commit bytes written into space obtained from uart_tx_reserve().
+ * @param intfnum Identifier of the UART interface.
+ * @param len Number of bytes written. May be less than was reserved.
+ * @param token Token against which the buffer lock is held.
+ */
+static inline void uart_tx_commit(uint8_t intfnum, uint8_t len, uint8_t token);
+
+/**
+ * @brief Write a set of buffers to the transmit buffer, in order.
+ * @param intfnum Identifier of the UART interface.
+ * @param iov Pointer to an array of buffer descriptors.
+ * @param iovcnt Number of descriptors in the array.
+ * @param token Token against which the buffer lock is held.
+ * @return Total number of bytes written.
+ */
+static inline uint16_t uart_writev(uint8_t intfnum, const hal_iovec_t * iov, 
+                                  uint8_t iovcnt, uint8_t token);
+
+/**
+ * @brief Get the contiguous unread data in the receive buffer.
+ * @param intfnum Identifier of the UART interface.
+ * @param ptr Set to the start of the unread data.
+ * @return Number of bytes readable at `ptr`. This may be less than 
+ *         uart_population_rxb() returns.
+ */
+static inline uint8_t uart_rx_peek(uint8_t intfnum, uint8_t ** ptr);
+
+/**
+ * @brief Mark data obtained from uart_rx_peek() as read.
+ * @param intfnum Identifier of the UART interface.
+ * @param len Number of bytes consumed.
+ */
+static inline void uart_rx_consume(uint8_t intfnum, uint8_t len);
+
+/**@}*/ 
+
 /**
  * @name Hardware Debug-Only UART API Functions
  */
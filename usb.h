@@ -49,6 +49,21 @@
  * 
  * @see usb_impl.h 
  * @see usb_impl.c
+ * 
+ * Host emulation : To allow the `usb_*` and `usbcdc_*` functions, and 
+ * `ptransport_usbcdc`, to be exercised without a device, an implementation 
+ * for a host platform can provide them over a pseudo-terminal or Unix 
+ * socket. Such an implementation should, at the least : 
+ * 
+ *  - Define the `ST_*` statuses used below, and move through them as a 
+ *    device would on connect, enumeration, suspend, resume and disconnect,
+ *    under the control of the test harness.
+ *  - Packetise CDC data into USBCDC_PACKET_SIZE byte packets, with short 
+ *    packets only on flush, and deliver no more than 
+ *    USB_EMU_PACKETS_PER_FRAME packets per endpoint in each emulated 
+ *    USB_FRAME_US frame. 
+ *  - Run the handlers that `usb_handlers.h` would run on the device from 
+ *    its frame scheduler, rather than from the calling thread. 
  */
 
 #ifndef HAL_UC_USB_H
@@ -87,6 +102,19 @@
 #define HUSB_ST_ERROR                   ST_ERROR
 /**@}*/ 
 
+/** \brief USB full speed frame period, in microseconds */
+#define USB_FRAME_US                    1000
+
+/** 
+ * \brief Bulk packets per endpoint per frame delivered by a host emulation.
+ * 
+ * Full speed hosts typically schedule upto 19 bulk packets of 64 bytes in 
+ * a frame on an otherwise idle bus. Lower values emulate a busier bus.
+ */
+#ifndef USB_EMU_PACKETS_PER_FRAME
+    #define USB_EMU_PACKETS_PER_FRAME   19
+#endif
+
 /**
  * @name USB Core Management API Functions
  * 
@@ -135,6 +163,33 @@ static inline void usb_disconnect(void);
  */
 static inline uint8_t usb_status(void);
 
+/**
+ * \brief USB state change callback.
+ * 
+ * \param status New status, as one of the allowed status defines.
+ * \param previous Previous status.
+ */
+typedef void (* usb_state_callback_t) (uint8_t status, uint8_t previous);
+
+/**
+ * \brief Register a callback for USB state changes.
+ * 
+ * The callback is called from the handlers in `usb_handlers.h` on each 
+ * change of the value usb_status() would return, including connect, 
+ * enumeration, suspend, resume and disconnect. It runs in interrupt context 
+ * and should be kept short. Only one callback is supported. Pass 0 to 
+ * remove it.
+ * 
+ * The handlers also take care of the HAL's own reactions to these changes 
+ * before calling the callback, such as pausing CDC TX (see usbcdc.h) and 
+ * releasing the USB power manager client on suspend or disconnect, so that
+ * the application does not need to poll usb_status() to stay within the 
+ * suspend current budget.
+ * 
+ * \param callback Function to be called on state changes.
+ */
+void usb_set_state_callback(usb_state_callback_t callback);
+
 /**@}*/ 
 
 #endif
@@ -34,12 +34,18 @@
 #include <stdarg.h>
 #include <platform/transport.h>
 #include <platform/types.h>
+#include "iovec.h"
 #include "map.h"
 
 #ifdef uC_INCLUDE_USB_IFACE
 
 #if uC_USBCDC_ENABLED
 
+/** \brief Size of the CDC data endpoints, and of each packet buffer. */
+#ifndef USBCDC_PACKET_SIZE
+    #define USBCDC_PACKET_SIZE          64
+#endif
+
 /**
  * @name USB CDC Interface API Functions
  *      
@@ -199,6 +205,353 @@ static inline void usbcdc_discard_rxb(uint8_t intfNum);
 
 /**@}*/
 
+/**
+ * @name USB CDC Suspend Handling API Functions
+ * 
+ * When the host suspends or disconnects the device, TX on every CDC 
+ * interface is paused by the USB handlers. While paused, every TX entry 
+ * point fails immediately, so producers do not spin on usbcdc_txready() : 
+ * 
+ *  - usbcdc_reqlock(), usbcdc_putc(), usbcdc_write() and usbcdc_writev() 
+ *    return 0.
+ *  - usbcdc_tx_reserve() returns 0 and reserves nothing.
+ *  - usbcdc_packet_borrow() returns 0.
+ * 
+ * Pending TX data on every path then follows the interface's suspend 
+ * policy. With USBCDC_SUSPEND_HOLD, data in the transmit buffer, committed 
+ * packets in the packet pool and data waiting in the interface's TX 
+ * scheduler queue are all kept, and sent in their original order on 
+ * resume. With USBCDC_SUSPEND_DISCARD, and always on disconnect, all of 
+ * them are dropped, committed packets being returned to the pool as free. 
+ * A packet which was borrowed before the pause and is committed during it 
+ * is treated the same way : held, or returned to the pool unsent. Space 
+ * reserved before the pause and committed during it is likewise kept or 
+ * dropped. TX is unpaused once the device is active again.
+ */
+/**@{*/ 
+
+/** \brief Hold pending TX data across suspend and send it on resume. */
+#define USBCDC_SUSPEND_HOLD             0
+
+/** \brief Discard pending TX data on suspend or disconnect. */
+#define USBCDC_SUSPEND_DISCARD          1
+
+/**
+ * \brief Set what is done with pending TX data when TX is paused.
+ * \param intfnum Interface Number
+ * \param policy One of the USBCDC_SUSPEND_* defines. A disconnect always 
+ *        discards.
+ */
+static inline void usbcdc_set_suspend_policy(uint8_t intfnum, uint8_t policy);
+
+/**
+ * \brief Check whether TX on the specified interface is paused.
+ * \param intfnum Interface Number
+ * \returns 1 if TX is paused due to suspend or disconnect, 0 otherwise.
+ */
+static inline uint8_t usbcdc_tx_paused(uint8_t intfnum);
+
+/**@}*/
+
+/**
+ * @name Zero-Copy and Vectored USBCDC API Functions
+ * 
+ * Reserve / commit and peek / consume access directly into the 
+ * implementation's transmit and receive buffers, and vectored writes, 
+ * so that protocol layers need not copy each message through an 
+ * intermediate buffer. 
+ * 
+ * Since the buffers are typically rings, reserve and peek return only the 
+ * contiguous region available at the current position. A caller needing 
+ * more should commit or consume what it got and then call again. 
+ * 
+ * As with usbcdc_write(), TX functions should be used with a held lock and 
+ * its token, and the application must subsequently trigger or flush 
+ * transmission. 
+ */
+/**@{*/ 
+
+/**
+ * @brief Reserve contiguous space in the transmit buffer.
+ * @param intfnum Identifier of the USBCDC interface.
+ * @param ptr Set to the start of the reserved space.
+ * @param token Token against which the buffer lock is held.
+ * @return Number of bytes which may be written at `ptr`. 0 for error.
+ */
+static inline uint8_t usbcdc_tx_reserve(uint8_t intfnum, uint8_t ** ptr, uint8_t token);
+
+/**
+ * @brief Commit bytes written into space obtained from usbcdc_tx_reserve().
+ * @param intfnum Identifier of the USBCDC interface.
+ * @param len Number of bytes written. May be less than was reserved.
+ * @param token Token against which the buffer lock is held.
+ */
+static inline void usbcdc_tx_commit(uint8_t intfnum, uint8_t len, uint8_t token);
+
+/**
+ * @brief Write a set of buffers to the transmit buffer, in order.
+ * @param intfnum Identifier of the USBCDC interface.
+ * @param iov Pointer to an array of buffer descriptors.
+ * @param iovcnt Number of descriptors in the array.
+ * @param token Token against which the buffer lock is held.
+ * @return Total number of bytes written.
+ */
+static inline uint16_t usbcdc_writev(uint8_t intfnum, const hal_iovec_t * iov, 
+                                    uint8_t iovcnt, uint8_t token);
+
+/**
+ * @brief Get the contiguous unread data in the receive buffer.
+ * @param intfnum Identifier of the USBCDC interface.
+ * @param ptr Set to the start of the unread data.
+ * @return Number of bytes readable at `ptr`. This may be less than 
+ *         usbcdc_population_rxb() returns.
+ */
+static inline uint8_t usbcdc_rx_peek(uint8_t intfnum, uint8_t ** ptr);
+
+/**
+ * @brief Mark data obtained from usbcdc_rx_peek() as read.
+ * @param intfnum Identifier of the USBCDC interface.
+ * @param len Number of bytes consumed.
+ */
+static inline void usbcdc_rx_consume(uint8_t intfnum, uint8_t len);
+
+/**@}*/ 
+
+#if APP_SUPPORT_USBCDC_COALESCE
+
+#if !APP_SUPPORT_SWTIMER
+    #error "APP_SUPPORT_USBCDC_COALESCE requires APP_SUPPORT_SWTIMER"
+#endif
+
+/**
+ * @name USB CDC TX Coalescing API Functions
+ * 
+ * In the coalescing TX mode, the application need not choose between 
+ * usbcdc_send_trigger() and usbcdc_send_flush(). It calls 
+ * usbcdc_send_trigger() after writing, as usual. Full packets are then sent 
+ * immediately, and any trailing partial packet is held back, in the manner 
+ * of Nagle's algorithm, until either more data fills it or the configured 
+ * latency bound expires since the oldest held byte was written, at which 
+ * point it is flushed as a short packet. An explicit usbcdc_send_flush() 
+ * still flushes immediately. 
+ * 
+ * The latency bound is kept using a software timer per interface, so the 
+ * software timer service must be available.
+ * 
+ * Packet counters are maintained in both modes, and can be used to tune 
+ * the latency bound against the proportion of short packets. 
+ */
+/**@{*/ 
+
+/** \brief Send only as triggered or flushed by the application. */
+#define USBCDC_TXMODE_MANUAL            0
+
+/** \brief Hold partial packets back upto a latency bound. */
+#define USBCDC_TXMODE_COALESCE          1
+
+typedef struct USBCDC_TXSTATS_t{
+    uint32_t full_packets;
+    uint32_t short_packets;
+    uint32_t bytes;
+}usbcdc_txstats_t;
+
+/**
+ * \brief Set the TX mode of the specified interface.
+ * \param intfnum Interface Number
+ * \param mode One of the USBCDC_TXMODE_* defines.
+ * \param latency_us Latency bound for partial packets, in microseconds. 
+ *        Ignored in USBCDC_TXMODE_MANUAL.
+ */
+void usbcdc_set_txmode(uint8_t intfnum, uint8_t mode, uint16_t latency_us);
+
+/**
+ * \brief Get the TX packet counters of the specified interface.
+ * \param intfnum Interface Number
+ */
+static inline const usbcdc_txstats_t * usbcdc_get_txstats(uint8_t intfnum);
+
+/**
+ * \brief Reset the TX packet counters of the specified interface.
+ * \param intfnum Interface Number
+ */
+static inline void usbcdc_clear_txstats(uint8_t intfnum);
+
+/**@}*/
+
+#endif
+
+#if APP_SUPPORT_USBCDC_TXSCHED
+
+/**
+ * @name USB CDC Composite TX Scheduling API Functions
+ * 
+ * On composite devices with several CDC interfaces, data triggered on each 
+ * interface is queued per interface, packet by packet, and a scheduler 
+ * decides which interface's queue feeds the IN endpoints next. This keeps 
+ * one busy interface, such as a log stream, from holding up replies on 
+ * another. 
+ * 
+ * In the weighted round robin policy, each interface sends upto its weight 
+ * in packets in each round. In the priority policy, the interface with the 
+ * highest weight which has a packet queued always goes next, and equal 
+ * weights are served round robin. The default weight of each interface is 1. 
+ * 
+ * Per interface counters record the data sent and the time packets spend 
+ * queued, from trigger or commit to being handed to the endpoint. 
+ */
+/**@{*/ 
+
+#define USBCDC_TXSCHED_WRR              0
+#define USBCDC_TXSCHED_PRIORITY         1
+
+typedef struct USBCDC_TXQSTATS_t{
+    uint32_t bytes;
+    uint32_t packets;
+    uint16_t max_latency_us;
+    uint32_t total_latency_us;
+}usbcdc_txqstats_t;
+
+/**
+ * \brief Set the scheduling policy across the CDC interfaces.
+ * \param policy One of the USBCDC_TXSCHED_* defines.
+ */
+void usbcdc_set_txsched(uint8_t policy);
+
+/**
+ * \brief Set the scheduling weight of the specified interface.
+ * \param intfnum Interface Number
+ * \param weight Packets per round, or priority, depending on the policy.
+ *        Must be at least 1.
+ */
+static inline void usbcdc_set_txweight(uint8_t intfnum, uint8_t weight);
+
+/**
+ * \brief Get the queue counters of the specified interface.
+ * \param intfnum Interface Number
+ */
+static inline const usbcdc_txqstats_t * usbcdc_get_txqstats(uint8_t intfnum);
+
+/**
+ * \brief Reset the queue counters of the specified interface.
+ * \param intfnum Interface Number
+ */
+static inline void usbcdc_clear_txqstats(uint8_t intfnum);
+
+/**@}*/
+
+#endif
+
+#if APP_SUPPORT_USBCDC_PACKET_TX
+
+/**
+ * @name USB CDC Zero-Copy Packet TX API Functions
+ * 
+ * Each interface has a pool of APP_USBCDC_TX_NPACKETS endpoint sized packet 
+ * buffers. The producer borrows a free buffer, fills it in place and 
+ * commits it, and it is then handed to the endpoint as is. There is no 
+ * copy into the implementation's transmit buffer and no repacking. With 
+ * two or more buffers, the producer can fill one while another is on the 
+ * wire. 
+ * 
+ * Committed packets are sent in the order they are committed. A packet 
+ * committed with less than USBCDC_PACKET_SIZE bytes is sent as a short 
+ * packet, which terminates the transfer on the host side. 
+ * 
+ * The packet API and the byte oriented API (usbcdc_putc(), usbcdc_write())
+ * should not be interleaved on the same interface without waiting for 
+ * usbcdc_txready() in between. 
+ */
+/**@{*/ 
+
+#ifndef APP_USBCDC_TX_NPACKETS
+    #define APP_USBCDC_TX_NPACKETS      2
+#endif
+
+/**
+ * \brief Borrow a free packet buffer from the specified interface's pool.
+ * \param intfnum Interface Number
+ * \returns Pointer to a USBCDC_PACKET_SIZE byte buffer, or 0 if none is 
+ *          free. 
+ */
+static inline uint8_t * usbcdc_packet_borrow(uint8_t intfnum);
+
+/**
+ * \brief Commit a borrowed packet buffer for transmission.
+ * \param intfnum Interface Number
+ * \param packet Pointer returned by usbcdc_packet_borrow().
+ * \param len Number of valid bytes in the packet, upto USBCDC_PACKET_SIZE.
+ */
+static inline void usbcdc_packet_commit(uint8_t intfnum, uint8_t * packet, 
+                                        uint8_t len);
+
+/**
+ * \brief Return a borrowed packet buffer to the pool without sending it.
+ * \param intfnum Interface Number
+ * \param packet Pointer returned by usbcdc_packet_borrow().
+ */
+static inline void usbcdc_packet_release(uint8_t intfnum, uint8_t * packet);
+
+/**
+ * \brief Get the number of free packet buffers in the interface's pool.
+ * \param intfnum Interface Number
+ */
+static inline uint8_t usbcdc_packet_available(uint8_t intfnum);
+
+/**@}*/
+
+#endif
+
+#if APP_SUPPORT_USBCDC_PACKET_RX
+
+/**
+ * @name USB CDC Packet RX API Functions
+ * 
+ * In the packet RX mode, each OUT packet is received directly into one of 
+ * APP_USBCDC_RX_NPACKETS packet buffers of the interface, and the callback 
+ * is called with a pointer to the packet and its length. The application 
+ * processes the packet in place, and returns the buffer with 
+ * usbcdc_packet_rx_done(), possibly later, from the main loop. Meanwhile, 
+ * the next packet is received into another free buffer. The host is NAKed 
+ * only when no buffer is free. 
+ * 
+ * The callback is called from the USB interrupt handler, and should either 
+ * be short or defer processing, such as by posting a scheduler task. While 
+ * the packet RX mode is enabled, the byte oriented RX functions 
+ * (usbcdc_getc(), usbcdc_read(), usbcdc_population_rxb()) are not used.
+ */
+/**@{*/ 
+
+#ifndef APP_USBCDC_RX_NPACKETS
+    #define APP_USBCDC_RX_NPACKETS      2
+#endif
+
+typedef void (* usbcdc_rx_callback_t) (uint8_t intfnum, uint8_t * packet, 
+                                       uint8_t len);
+
+/**
+ * \brief Enable the packet RX mode on the specified interface.
+ * \param intfnum Interface Number
+ * \param callback Function to be called with each received packet. 
+ */
+void usbcdc_packet_rx_enable(uint8_t intfnum, usbcdc_rx_callback_t callback);
+
+/**
+ * \brief Return to the byte oriented RX mode on the specified interface.
+ * \param intfnum Interface Number
+ */
+void usbcdc_packet_rx_disable(uint8_t intfnum);
+
+/**
+ * \brief Return a received packet's buffer to the interface for reuse.
+ * \param intfnum Interface Number
+ * \param packet Pointer previously passed to the callback.
+ */
+static inline void usbcdc_packet_rx_done(uint8_t intfnum, uint8_t * packet);
+
+/**@}*/
+
+#endif
+
 extern const pluggable_transport_t ptransport_usbcdc;
 
 #endif 